@@ -0,0 +1,171 @@
+#ifndef COMPACT_ADJACENCY_H
+#define COMPACT_ADJACENCY_H
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "Graph.h"
+
+//* Set to 0 to keep the vertices in the order of the graph (Locations.csv order) instead of renumbering them
+#ifndef ADJACENCY_REORDER
+#define ADJACENCY_REORDER 1
+#endif
+
+/**
+ * @brief Outgoing edges of every vertex of a graph stored in flat arrays (compressed sparse rows).
+ *
+ * Vertices are renumbered into positions with a Reverse Cuthill-McKee order, so vertices close in the road network
+ * get close positions and a search touches fewer cache lines of the arrays and of its labels. The graph and the
+ * vertices themselves are not changed (indices, ids and codes stay the same), position(index) and vertices() map
+ * between both numberings.
+ *
+ * The edges of the vertex at position p are the entries [firstEdge(p), endEdge(p)) of every array, in the same
+ * order as the vertex adjacency list. Targets and weights being contiguous lets a search relax a whole block of
+ * edges at once instead of following one pointer per edge.
+ *
+ * The arrays are a snapshot: refresh rebuilds them when the graph is a different one, gained vertices or edges,
+ * or lost some since they were built. Weights mirror one EdgeWeights snapshot, which is held until the next refresh, so a
+ * search reading them sees a single version of every edge. When only weights changed, refresh copies the blocks of the
+ * new snapshot that are not shared with the old one into place, instead of building everything again.
+ */
+template <class T>
+class CompactAdjacency
+{
+public:
+    /**
+     * @brief Makes the arrays match the graph and its current weights snapshot, rebuilding them only if its edges
+     * changed since the last call and patching the weights that changed otherwise.
+     *
+     * O(|V| log |V| + |E| log d) time complexity when rebuilding, where d is the largest degree, O(|E| / B + C B) when
+     * patching, where B is EDGE_WEIGHT_BLOCK and C the amount of blocks that changed, O(1) otherwise.
+     */
+    void refresh(const Graph<T>* g) {
+        std::shared_ptr<const EdgeWeights> current = g->getWeights();
+        if (g == graph && g->getStructureVersion() == structureVersion && g->getCodeVertex() == (int)vertexList.size() && g->getEdgeCount() == edgeCount) {
+            if (current != weights) patch(current);
+            return;
+        }
+        graph = g;
+        structureVersion = g->getStructureVersion();
+        edgeCount = g->getEdgeCount();
+        weights = current;
+        orderVertices(g->getVertexSet());
+
+        offsets.assign(1, 0);
+        offsets.reserve(vertexList.size() + 1);
+        targetList.clear();
+        driveList.clear();
+        walkList.clear();
+        edgeList.clear();
+        edgePosition.assign(edgeCount, -1);
+        for (Vertex<T>* v : vertexList) {
+            for (Edge<T>* e : v->getAdj()) {
+                edgePosition[e->getIndex()] = targetList.size();
+                targetList.push_back(positionList[e->getDest()->getIndex()]);
+                driveList.push_back(weights->driveTime(e->getIndex()));
+                walkList.push_back(weights->walkTime(e->getIndex()));
+                edgeList.push_back(e);
+            }
+            offsets.push_back(targetList.size());
+        }
+    }
+
+    //* Position of the vertex with the given index
+    int position(int index) const { return positionList[index]; }
+    int firstEdge(int position) const { return offsets[position]; }
+    int endEdge(int position) const { return offsets[position + 1]; }
+
+    //* Position of the destination of every edge
+    const int* targets() const { return targetList.data(); }
+    const double* driveTimes() const { return driveList.data(); }
+    const double* walkTimes() const { return walkList.data(); }
+    Edge<T>* edge(int i) const { return edgeList[i]; }
+    //* The vertices by position
+    const std::vector<Vertex<T>*>& vertices() const { return vertexList; }
+
+private:
+    const Graph<T>* graph = nullptr;
+    unsigned long structureVersion = 0;
+    int edgeCount = 0;
+    std::shared_ptr<const EdgeWeights> weights; //* the snapshot the weights mirror
+    std::vector<int> edgePosition; //* position of every edge in the arrays by edge index, -1 if removed
+    std::vector<Vertex<T>*> vertexList;
+    std::vector<int> positionList;
+    std::vector<int> offsets;
+    std::vector<int> targetList;
+    std::vector<double> driveList, walkList;
+    std::vector<Edge<T>*> edgeList;
+
+    //* Copies the weights of the blocks of current that the snapshot mirrored so far doesn't share
+    void patch(const std::shared_ptr<const EdgeWeights>& current) {
+        for (int b = 0; b < current->getBlockCount(); b++) {
+            if (current->getBlock(b) == weights->getBlock(b)) continue;
+            int end = std::min(edgeCount, (b + 1) * EDGE_WEIGHT_BLOCK);
+            for (int i = b * EDGE_WEIGHT_BLOCK; i < end; i++) {
+                if (edgePosition[i] == -1) continue;
+                driveList[edgePosition[i]] = current->driveTime(i);
+                walkList[edgePosition[i]] = current->walkTime(i);
+            }
+        }
+        weights = current;
+    }
+
+    /**
+     * @brief Fills vertexList and positionList. Every connected part (following edges in both directions) is
+     * visited breadth first from one of its vertices of lowest degree, with the neighbours of each vertex taken
+     * by increasing degree, and the resulting order is reversed.
+     */
+    void orderVertices(const std::vector<Vertex<T>*>& graphVertices) {
+        int n = graphVertices.size();
+        positionList.assign(n, 0);
+        vertexList = graphVertices;
+        if (!ADJACENCY_REORDER) {
+            for (int i = 0; i < n; i++) positionList[i] = i;
+            return;
+        }
+
+        std::vector<int> degree(n);
+        for (Vertex<T>* v : graphVertices) degree[v->getIndex()] = v->getAdj().size() + v->getIncoming().size();
+        std::vector<int> byDegree(n);
+        for (int i = 0; i < n; i++) byDegree[i] = i;
+        std::stable_sort(byDegree.begin(), byDegree.end(), [&](int a, int b) { return degree[a] < degree[b]; });
+
+        std::vector<int> order;
+        order.reserve(n);
+        std::vector<bool> seen(n, false);
+        std::vector<std::pair<int, int>> next; // (degree, index) of the unseen neighbours of a vertex
+        for (int start : byDegree) {
+            if (seen[start]) continue;
+            seen[start] = true;
+            order.push_back(start);
+            for (size_t head = order.size() - 1; head < order.size(); head++) {
+                Vertex<T>* v = graphVertices[order[head]];
+                next.clear();
+                for (Edge<T>* e : v->getAdj()) {
+                    int w = e->getDest()->getIndex();
+                    if (!seen[w]) {
+                        seen[w] = true;
+                        next.emplace_back(degree[w], w);
+                    }
+                }
+                for (Edge<T>* e : v->getIncoming()) {
+                    int w = e->getOrig()->getIndex();
+                    if (!seen[w]) {
+                        seen[w] = true;
+                        next.emplace_back(degree[w], w);
+                    }
+                }
+                std::sort(next.begin(), next.end());
+                for (const std::pair<int, int>& w : next) order.push_back(w.second);
+            }
+        }
+
+        for (int p = 0; p < n; p++) {
+            vertexList[p] = graphVertices[order[n - 1 - p]];
+            positionList[order[n - 1 - p]] = p;
+        }
+    }
+};
+
+#endif //COMPACT_ADJACENCY_H
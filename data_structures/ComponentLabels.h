@@ -0,0 +1,148 @@
+#ifndef COMPONENT_LABELS_H
+#define COMPONENT_LABELS_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "Graph.h"
+
+/**
+ * @brief Connected and strongly connected component labels of the walking and driving networks of a graph, so a
+ * query between vertices that can't reach each other is answered without any search.
+ *
+ * The network of a metric (a Distance, as in ShortestPathTreeCache) holds the edges whose weight for it is not INF,
+ * so segments that can't be driven are not part of the driving network. Every vertex gets the weakly connected
+ * component it is in and its strongly connected component, numbered by Tarjan's algorithm in reverse topological
+ * order: an edge between two strongly connected components always goes to the one with the lower number. So there is
+ * no path from a to b if they are in different weak components or b's strong component has a higher number than a's,
+ * which also covers directed data where both are connected only one way.
+ *
+ * Restrictions only remove edges, so a pair with no path in the whole network has none under any restrictions.
+ */
+template <class T>
+class ComponentLabels
+{
+public:
+    /**
+     * @brief Labels both networks of g.
+     *
+     * O(|V| + |E|) time complexity.
+     */
+    void build(const Graph<T>* g) {
+        vertices = g->getVertexSet();
+        for (int metric = 0; metric < 2; metric++) label(metric);
+    }
+
+    /**
+     * @brief Whether there may be a path from the vertex at index from to the one at index to in the network of
+     * metric. false only when there is certainly none, true as well if the labels were not built for that many vertices.
+     *
+     * O(1) time complexity.
+     */
+    bool mayReach(int from, int to, int metric) const {
+        const std::vector<int>& strong = strongLabels[metric];
+        if ((size_t)from >= strong.size() || (size_t)to >= strong.size()) return true;
+        return weakLabels[metric][from] == weakLabels[metric][to] && strong[from] >= strong[to];
+    }
+
+    //* Whether there is a path both ways between the vertices at indices a and b
+    bool stronglyConnected(int a, int b, int metric) const {
+        const std::vector<int>& strong = strongLabels[metric];
+        return (size_t)a < strong.size() && (size_t)b < strong.size() && strong[a] == strong[b];
+    }
+
+    /**
+     * @brief Keeps the labels of a metric right after the weight of an edge (and its reverse) changed for it.
+     *
+     * Only an edge joining or leaving the network can change them. A new edge inside a strong component or a removed
+     * one between two of them changes nothing that mayReach relies on (the numbering stays a topological order, and
+     * old weak components are still correct, only less precise), any other change relabels the network.
+     *
+     * O(1) time complexity, O(|V| + |E|) when the network is relabeled.
+     */
+    void update(Edge<T>* edge, int metric, double oldWeight, double newWeight) {
+        if (strongLabels[metric].empty()) return;
+        bool was = oldWeight != INF, is = newWeight != INF;
+        if (was == is) return;
+        bool inside = stronglyConnected(edge->getOrig()->getIndex(), edge->getDest()->getIndex(), metric);
+        if (is != inside) label(metric);
+    }
+
+private:
+    std::vector<Vertex<T>*> vertices;
+    std::vector<int> weakLabels[2], strongLabels[2];
+
+    static double weight(const Edge<T>* e, int metric) { return metric == 0 ? e->getWalkTime() : e->getDriveTime(); }
+
+    static int find(std::vector<int>& roots, int v) {
+        while (roots[v] != v) v = roots[v] = roots[roots[v]];
+        return v;
+    }
+
+    //* Weak components with a union find, then strong components with an iterative Tarjan's algorithm
+    void label(int metric) {
+        int n = vertices.size();
+        //* the edges of the network in flat arrays, the adjacency lists of the graph are copies
+        std::vector<int> offsets(1, 0), targets;
+        std::vector<int> roots(n);
+        for (int i = 0; i < n; i++) roots[i] = i;
+        std::vector<Vertex<T>*> byIndex(n);
+        for (Vertex<T>* v : vertices) byIndex[v->getIndex()] = v;
+        for (Vertex<T>* v : byIndex) {
+            for (Edge<T>* e : v->getAdj()) {
+                if (weight(e, metric) == INF) continue;
+                int w = e->getDest()->getIndex();
+                targets.push_back(w);
+                roots[find(roots, v->getIndex())] = find(roots, w);
+            }
+            offsets.push_back(targets.size());
+        }
+        std::vector<int>& weak = weakLabels[metric];
+        weak.assign(n, 0);
+        for (int v = 0; v < n; v++) weak[v] = find(roots, v);
+
+        std::vector<int>& strong = strongLabels[metric];
+        strong.assign(n, -1);
+        std::vector<int> order(n, -1), low(n, 0), stack;
+        std::vector<bool> onStack(n, false);
+        std::vector<std::pair<int, int>> calls; // vertex and its next edge
+        int visited = 0, components = 0;
+        for (int root = 0; root < n; root++) {
+            if (order[root] != -1) continue;
+            calls.emplace_back(root, offsets[root]);
+            order[root] = low[root] = visited++;
+            stack.push_back(root);
+            onStack[root] = true;
+            while (!calls.empty()) {
+                int v = calls.back().first;
+                int& next = calls.back().second;
+                if (next < offsets[v + 1]) {
+                    int w = targets[next++];
+                    if (order[w] == -1) {
+                        order[w] = low[w] = visited++;
+                        stack.push_back(w);
+                        onStack[w] = true;
+                        calls.emplace_back(w, offsets[w]);
+                    }
+                    else if (onStack[w]) {
+                        low[v] = std::min(low[v], order[w]);
+                    }
+                    continue;
+                }
+                calls.pop_back();
+                if (!calls.empty()) low[calls.back().first] = std::min(low[calls.back().first], low[v]);
+                if (low[v] != order[v]) continue;
+                int w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack[w] = false;
+                    strong[w] = components;
+                } while (w != v);
+                components++;
+            }
+        }
+    }
+};
+
+#endif //COMPONENT_LABELS_H
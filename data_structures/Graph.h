@@ -9,8 +9,14 @@
 #include <queue>
 #include <limits>
 #include <algorithm>
+#include <memory>
 #include "../data_structures/MutablePriorityQueue.h"
 
+//* Edges per block of an EdgeWeights snapshot, an update copies the blocks of its edges and the table of blocks
+#ifndef EDGE_WEIGHT_BLOCK
+#define EDGE_WEIGHT_BLOCK 1024
+#endif
+
 template <class T>
 class Edge;
 
@@ -48,6 +54,9 @@ public:
     void setCode(std::string code);
     int getParking() const;
     void setParking(int value);
+    //* position of the vertex inside the graph's vertexSet, kept up to date by the Graph
+    int getIndex() const;
+    void setIndex(int index);
 
     void setIndegree(unsigned int indegree);
     void setDist(double dist);
@@ -56,6 +65,8 @@ public:
     Edge<T>* addEdge(Vertex<T>* dest, double walkTime, double driveTime);
     bool removeEdge(T in);
     void removeOutgoingEdges();
+    //* Makes room for the given amount of extra outgoing and incoming edges, so adding them never reallocates
+    void reserveEdges(size_t outgoing, size_t incoming);
 
     friend class MutablePriorityQueue<Vertex>;
 protected:
@@ -66,8 +77,9 @@ protected:
     bool visited = false; // used by DFS, BFS, Prim ...
     bool processing = false; // used by isDAG (in addition to the visited attribute)
     std::string location = "", code = ""; // * Used for the purposes of this project
-    //* could be boolean, 0 if no parking, non-zero otherwise
+    //* capacity of the car park (spaces), 0 if there is none
     int parking;
+    int index = -1; //* index in the vertexSet
     unsigned int indegree; // used by topsort
     double dist = 0;
     Edge<T>* path = nullptr;
@@ -97,16 +109,22 @@ public:
     double getFlow() const;
     double getWalkTime() const;
     double getDriveTime() const;
+    //* unique index of the edge inside its graph, given by the Graph when the edge is added
+    int getIndex() const;
+    void setIndex(int index);
 
     void setSelected(bool selected);
     void setReverse(Edge<T>* reverse);
     void setFlow(double flow);
+    void setWalkTime(double walkTime);
+    void setDriveTime(double driveTime);
 protected:
     Vertex<T>* dest; // destination vertex
     double weight; // edge weight, can also be used for capacity
     double walkTime = 0, driveTime = 0; //* new auxiliary variables for the project
     // auxiliary fields
     bool selected = false;
+    int index = -1;
 
     // used for bidirectional edges
     Vertex<T>* orig;
@@ -115,6 +133,55 @@ protected:
     double flow; // for flow-related problems
 };
 
+/********************** EdgeWeights  ****************************/
+
+/**
+ * @brief Walking and driving times of every edge of a graph at one version, by edge index. Never changed once published.
+ *
+ * Graph::updateEdge copies the blocks holding the edge and its reverse into a new snapshot that shares every other block,
+ * and publishes it. Whatever holds the old snapshot keeps reading it, so a search that pins the snapshot when it starts
+ * sees every edge at one version, both directions of an update or neither, until it ends. Two snapshots share a block
+ * (the same object) only if none of its edges changed between them, which tells consumers what they must patch.
+ */
+class EdgeWeights
+{
+public:
+    struct Block
+    {
+        double walk[EDGE_WEIGHT_BLOCK];
+        double drive[EDGE_WEIGHT_BLOCK];
+    };
+
+    //* Graph::getVersion of the graph when the snapshot was published
+    unsigned long getVersion() const { return version; }
+    //* Upper bound (exclusive) of the edge indices covered
+    int getEdgeCount() const { return edgeCount; }
+    double walkTime(int edge) const { return blocks[edge / EDGE_WEIGHT_BLOCK]->walk[edge % EDGE_WEIGHT_BLOCK]; }
+    double driveTime(int edge) const { return blocks[edge / EDGE_WEIGHT_BLOCK]->drive[edge % EDGE_WEIGHT_BLOCK]; }
+    int getBlockCount() const { return blocks.size(); }
+    const Block* getBlock(int b) const { return blocks[b].get(); }
+
+private:
+    template <class T>
+    friend class Graph;
+
+    unsigned long version = 0;
+    int edgeCount = 0;
+    std::vector<std::shared_ptr<const Block>> blocks;
+
+    //* Sets the times of an edge, copying its block first if it is still shared with published
+    void set(int edge, double walkTime, double driveTime, const EdgeWeights* published) {
+        int b = edge / EDGE_WEIGHT_BLOCK;
+        if (published != nullptr && b < published->getBlockCount() && blocks[b] == published->blocks[b]) {
+            blocks[b] = std::make_shared<const Block>(*blocks[b]);
+        }
+        //* only blocks no published snapshot holds yet are written
+        Block* block = const_cast<Block*>(blocks[b].get());
+        block->walk[edge % EDGE_WEIGHT_BLOCK] = walkTime;
+        block->drive[edge % EDGE_WEIGHT_BLOCK] = driveTime;
+    }
+};
+
 /********************** Graph  ****************************/
 
 template <class T>
@@ -156,14 +223,39 @@ public:
     bool removeEdge(const T& source, const T& dest);
     bool addBidirectionalEdge(const T& sourc, const T& dest, double w);
     bool addBidirectionalEdge(const std::string& sourc, const std::string& dest, double walkTime, double driveTime);
+    //* Same as above with the vertices already found, both must belong to this graph
+    bool addBidirectionalEdge(Vertex<T>* v1, Vertex<T>* v2, double walkTime, double driveTime);
+    /*
+     * Changes the walking and driving times of an edge and of its reverse, if it has one, and moves the graph to a new version.
+     * Both are published at once in a new EdgeWeights snapshot, searches that pinned an older one keep reading it.
+     * The Edge fields are changed too, for the code reading them outside of searches. Updates must come from one thread.
+     */
+    void updateEdge(Edge<T>* edge, double walkTime, double driveTime);
+    /*
+     * Version of the edges, incremented by every updateEdge and removal, so anything derived from them can tell it is stale.
+     */
+    unsigned long getVersion() const;
+    //* Incremented only by removals, which change the edges or vertex indices and not just weights
+    unsigned long getStructureVersion() const;
+    /*
+     * The current weights snapshot, held for as long as the returned pointer lives. It is built from the edges the first
+     * time after edges were added, which happens while loading, before any search runs.
+     */
+    std::shared_ptr<const EdgeWeights> getWeights() const;
 
     int getCodeVertex() const;
+    //* Upper bound (exclusive) of the edge indices
+    int getEdgeCount() const;
 
     std::vector<Vertex<T>*> getVertexSet() const;
 
 
 protected:
     std::vector<Vertex<T>*> vertexSet;    // vertex set
+    unsigned long version = 0; //* incremented whenever edge weights change or edges are removed
+    unsigned long structureVersion = 0; //* incremented whenever edges are removed
+    mutable std::shared_ptr<const EdgeWeights> weights; //* published with std::atomic_store
+    int edgeCount = 0; //* edges ever added, used to index them
 
     double** distMatrix = nullptr;   // dist matrix for Floyd-Warshall
     int** pathMatrix = nullptr;   // path matrix for Floyd-Warshall
@@ -211,6 +303,12 @@ Edge<T>* Vertex<T>::addEdge(Vertex<T>* dest, double walkTime, double driveTime)
     return newEdge;
 }
 
+template <class T>
+void Vertex<T>::reserveEdges(size_t outgoing, size_t incoming) {
+    adj.reserve(adj.size() + outgoing);
+    this->incoming.reserve(this->incoming.size() + incoming);
+}
+
 /*
  * Auxiliary function to remove an outgoing edge (with a given destination (d))
  * from a vertex (this).
@@ -288,6 +386,16 @@ void Vertex<T>::setParking(int value) {
     this->parking = value;
 }
 
+template <class T>
+int Vertex<T>::getIndex() const {
+    return this->index;
+}
+
+template <class T>
+void Vertex<T>::setIndex(int index) {
+    this->index = index;
+}
+
 template <class T>
 std::vector<Edge<T>*> Vertex<T>::getAdj() const {
     return this->adj;
@@ -433,6 +541,26 @@ void Edge<T>::setFlow(double flow) {
     this->flow = flow;
 }
 
+template <class T>
+int Edge<T>::getIndex() const {
+    return this->index;
+}
+
+template <class T>
+void Edge<T>::setIndex(int index) {
+    this->index = index;
+}
+
+template <class T>
+void Edge<T>::setWalkTime(double walkTime) {
+    this->walkTime = walkTime;
+}
+
+template <class T>
+void Edge<T>::setDriveTime(double driveTime) {
+    this->driveTime = driveTime;
+}
+
 /********************** Graph  ****************************/
 
 template <class T>
@@ -440,6 +568,11 @@ int Graph<T>::getCodeVertex() const {
     return vertexSet.size();
 }
 
+template <class T>
+int Graph<T>::getEdgeCount() const {
+    return edgeCount;
+}
+
 template <class T>
 std::vector<Vertex<T>*> Graph<T>::getVertexSet() const {
     return vertexSet;
@@ -490,6 +623,7 @@ bool Graph<T>::addVertex(const T& in) {
     if (findVertex(in) != nullptr)
         return false;
     vertexSet.push_back(new Vertex<T>(in));
+    vertexSet.back()->setIndex(vertexSet.size() - 1);
     return true;
 }
 
@@ -500,6 +634,7 @@ bool Graph<T>::addVertex(const std::string& name, const int& id, const std::stri
     if (findVertex(id) != nullptr)
         return false;
     vertexSet.push_back(new Vertex<T>(name,id,code,parking));
+    vertexSet.back()->setIndex(vertexSet.size() - 1);
     return true;
 }
 
@@ -519,6 +654,10 @@ bool Graph<T>::removeVertex(const T& in) {
             }
             vertexSet.erase(it);
             delete v;
+            for (unsigned i = 0; i < vertexSet.size(); i++)
+                vertexSet[i]->setIndex(i);
+            version++;
+            structureVersion++;
             return true;
         }
     }
@@ -536,7 +675,7 @@ bool Graph<T>::addEdge(const T& sourc, const T& dest, double w) {
     auto v2 = findVertex(dest);
     if (v1 == nullptr || v2 == nullptr)
         return false;
-    v1->addEdge(v2, w);
+    v1->addEdge(v2, w)->setIndex(edgeCount++);
     return true;
 }
 
@@ -546,7 +685,7 @@ bool Graph<T>::addEdge(const std::string& sourc, const std::string& dest, double
     Vertex<T>* v2 = findVertex(dest);
     if (v1 == nullptr || v2 == nullptr)
         return false;
-    v1->addEdge(v2, walkTime, driveTime);
+    v1->addEdge(v2, walkTime, driveTime)->setIndex(edgeCount++);
     return true;
 }
 /*
@@ -560,7 +699,10 @@ bool Graph<T>::removeEdge(const T& sourc, const T& dest) {
     if (srcVertex == nullptr) {
         return false;
     }
-    return srcVertex->removeEdge(dest);
+    if (!srcVertex->removeEdge(dest)) return false;
+    version++;
+    structureVersion++;
+    return true;
 }
 
 template <class T>
@@ -571,6 +713,8 @@ bool Graph<T>::addBidirectionalEdge(const T& sourc, const T& dest, double w) {
         return false;
     auto e1 = v1->addEdge(v2, w);
     auto e2 = v2->addEdge(v1, w);
+    e1->setIndex(edgeCount++);
+    e2->setIndex(edgeCount++);
     e1->setReverse(e2);
     e2->setReverse(e1);
     return true;
@@ -578,17 +722,72 @@ bool Graph<T>::addBidirectionalEdge(const T& sourc, const T& dest, double w) {
 
 template <class T>
 bool Graph<T>::addBidirectionalEdge(const std::string& sourc, const std::string& dest, double walkTime, double driveTime) {
-    auto v1 = findVertex(sourc);
-    auto v2 = findVertex(dest);
+    return addBidirectionalEdge(findVertex(sourc), findVertex(dest), walkTime, driveTime);
+}
+
+template <class T>
+bool Graph<T>::addBidirectionalEdge(Vertex<T>* v1, Vertex<T>* v2, double walkTime, double driveTime) {
     if (v1 == nullptr || v2 == nullptr)
         return false;
     auto e1 = v1->addEdge(v2, walkTime,driveTime);
     auto e2 = v2->addEdge(v1, walkTime,driveTime);
+    e1->setIndex(edgeCount++);
+    e2->setIndex(edgeCount++);
     e1->setReverse(e2);
     e2->setReverse(e1);
     return true;
 }
 
+template <class T>
+void Graph<T>::updateEdge(Edge<T>* edge, double walkTime, double driveTime) {
+    std::shared_ptr<const EdgeWeights> published = getWeights();
+    std::shared_ptr<EdgeWeights> next = std::make_shared<EdgeWeights>(*published); // shares every block
+    next->version = version + 1;
+    next->set(edge->getIndex(), walkTime, driveTime, published.get());
+    if (edge->getReverse() != nullptr) {
+        next->set(edge->getReverse()->getIndex(), walkTime, driveTime, published.get());
+    }
+    std::atomic_store(&weights, std::shared_ptr<const EdgeWeights>(std::move(next)));
+
+    edge->setWalkTime(walkTime);
+    edge->setDriveTime(driveTime);
+    if (edge->getReverse() != nullptr) {
+        edge->getReverse()->setWalkTime(walkTime);
+        edge->getReverse()->setDriveTime(driveTime);
+    }
+    version++;
+}
+
+template <class T>
+unsigned long Graph<T>::getVersion() const {
+    return version;
+}
+
+template <class T>
+unsigned long Graph<T>::getStructureVersion() const {
+    return structureVersion;
+}
+
+template <class T>
+std::shared_ptr<const EdgeWeights> Graph<T>::getWeights() const {
+    std::shared_ptr<const EdgeWeights> current = std::atomic_load(&weights);
+    if (current != nullptr && current->getEdgeCount() == edgeCount) return current;
+    std::shared_ptr<EdgeWeights> built = std::make_shared<EdgeWeights>();
+    built->version = version;
+    built->edgeCount = edgeCount;
+    for (int b = 0; b * EDGE_WEIGHT_BLOCK < edgeCount; b++) {
+        built->blocks.push_back(std::make_shared<const EdgeWeights::Block>());
+    }
+    for (Vertex<T>* v : vertexSet) {
+        for (Edge<T>* e : v->getAdj()) {
+            built->set(e->getIndex(), e->getWalkTime(), e->getDriveTime(), nullptr);
+        }
+    }
+    current = built;
+    std::atomic_store(&weights, current);
+    return current;
+}
+
 inline void deleteMatrix(int** m, int n) {
     if (m != nullptr) {
         for (int i = 0; i < n; i++)
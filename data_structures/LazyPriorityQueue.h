@@ -0,0 +1,48 @@
+#ifndef LAZY_PRIORITY_QUEUE_H
+#define LAZY_PRIORITY_QUEUE_H
+
+#include <queue>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Priority queue with the same interface as MutablePriorityQueue, for elements with a getDist() key.
+ *
+ * decreaseKey pushes the element again instead of moving it inside the heap, and outdated entries (whose key is no
+ * longer the element's dist) are dropped when they reach the top. There is no queueIndex to maintain, which makes
+ * every operation cheaper, but elements with equal keys may come out in a different order than MutablePriorityQueue.
+ * Keys may only decrease while an element is in the queue, as in Dijkstra.
+ */
+template <class T>
+class LazyPriorityQueue
+{
+public:
+    void insert(T* x) { heap.push(Entry(x->getDist(), x)); }
+    void decreaseKey(T* x) { heap.push(Entry(x->getDist(), x)); }
+
+    T* extractMin() {
+        dropOutdated();
+        T* x = heap.top().second;
+        heap.pop();
+        return x;
+    }
+
+    bool empty() {
+        dropOutdated();
+        return heap.empty();
+    }
+
+private:
+    typedef std::pair<double, T*> Entry;
+    struct Greater
+    {
+        bool operator()(const Entry& a, const Entry& b) const { return a.first > b.first; }
+    };
+    std::priority_queue<Entry, std::vector<Entry>, Greater> heap;
+
+    void dropOutdated() {
+        while (!heap.empty() && heap.top().first != heap.top().second->getDist()) heap.pop();
+    }
+};
+
+#endif //LAZY_PRIORITY_QUEUE_H
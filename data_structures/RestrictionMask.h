@@ -0,0 +1,98 @@
+#ifndef RESTRICTION_MASK_H
+#define RESTRICTION_MASK_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Per query restrictions over vertex and edge indices, kept outside of the graph.
+ *
+ * Three bitsets are kept:
+ * - blocked vertices: never reached nor expanded (avoided nodes).
+ * - skipped vertices: may be reached but are not expanded (inner vertices of a path an alternative must avoid).
+ * - blocked edges: never relaxed (avoided segments).
+ *
+ * Every 64 bit word has a generation stamp and only counts if it matches the current generation, so clearing
+ * the whole mask is just moving to a new generation. Setting a bit is O(1) and clearing the mask is O(1).
+ */
+class RestrictionMask
+{
+public:
+    /**
+     * @brief Makes room for the given amount of vertex and edge indices, clearing the mask.
+     * Does nothing but clearing if the sizes are the same as before.
+     *
+     * O(|V| + |E|) time complexity if the sizes change, O(1) otherwise.
+     */
+    void resize(size_t vertices, size_t edges) {
+        if (vertices != vertexCount || edges != edgeCount) {
+            vertexCount = vertices;
+            edgeCount = edges;
+            blockedVertices.resize(vertices);
+            skippedVertices.resize(vertices);
+            blockedEdges.resize(edges);
+        }
+        clear();
+    }
+
+    //* Lifts every restriction
+    void clear() {
+        if (++generation == 0) { // wrapped around, old stamps could match again
+            blockedVertices.reset();
+            skippedVertices.reset();
+            blockedEdges.reset();
+            generation = 1;
+        }
+    }
+
+    void blockVertex(int index) { blockedVertices.set(index, generation); }
+    void skipVertex(int index) { skippedVertices.set(index, generation); }
+    void blockEdge(int index) { blockedEdges.set(index, generation); }
+
+    //* True if the search must not expand the vertex
+    bool stopsAt(int vertex) const {
+        return (blockedVertices.test(vertex, generation) | skippedVertices.test(vertex, generation)) != 0;
+    }
+
+    //* True if the search must not relax the edge with the given index towards the given vertex
+    bool excludes(int edge, int dest) const {
+        return (blockedEdges.test(edge, generation) | blockedVertices.test(dest, generation)) != 0;
+    }
+
+private:
+    struct Bits
+    {
+        std::vector<uint64_t> words;
+        std::vector<uint32_t> stamps;
+
+        void resize(size_t n) {
+            words.assign((n + 63) / 64, 0);
+            stamps.assign(words.size(), 0);
+        }
+
+        void reset() {
+            stamps.assign(stamps.size(), 0);
+        }
+
+        void set(int i, uint32_t generation) {
+            size_t w = i >> 6;
+            if (stamps[w] != generation) {
+                stamps[w] = generation;
+                words[w] = 0;
+            }
+            words[w] |= uint64_t(1) << (i & 63);
+        }
+
+        //* 1 if set in the current generation, 0 otherwise, without branches
+        uint64_t test(int i, uint32_t generation) const {
+            size_t w = i >> 6;
+            return (words[w] >> (i & 63)) & uint64_t(stamps[w] == generation);
+        }
+    };
+
+    Bits blockedVertices, skippedVertices, blockedEdges;
+    size_t vertexCount = 0, edgeCount = 0;
+    uint32_t generation = 1;
+};
+
+#endif //RESTRICTION_MASK_H
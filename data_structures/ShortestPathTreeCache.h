@@ -0,0 +1,215 @@
+#ifndef SHORTEST_PATH_TREE_CACHE_H
+#define SHORTEST_PATH_TREE_CACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "Graph.h"
+
+/**
+ * @brief Writes the canonical form of a set of restrictions: vertex indices sorted and without duplicates, and
+ * avoided segments as sorted (smaller index, bigger index) pairs, since avoiding an edge also avoids its reverse.
+ *
+ * O(k log k) time complexity, where k is the amount of restrictions.
+ */
+template <class T>
+void canonicalRestrictions(const std::vector<Vertex<T>*>& nAvoid, const std::vector<Edge<T>*>& eAvoid,
+    std::vector<int>& nodes, std::vector<std::pair<int, int>>& segments) {
+    nodes.clear();
+    segments.clear();
+    for (Vertex<T>* v : nAvoid) {
+        nodes.push_back(v->getIndex());
+    }
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+    for (Edge<T>* e : eAvoid) {
+        int a = e->getOrig()->getIndex(), b = e->getDest()->getIndex();
+        segments.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+    }
+    std::sort(segments.begin(), segments.end());
+    segments.erase(std::unique(segments.begin(), segments.end()), segments.end());
+}
+
+/**
+ * @brief Identifies a shortest path tree: the vertex the search started from, the metric used
+ * and the canonical restrictions that were applied to the graph.
+ */
+struct PathTreeKey
+{
+    int origin = -1;
+    int metric = 0;
+    std::vector<int> avoidNodes;
+    std::vector<std::pair<int, int>> avoidSegments;
+
+    bool operator==(const PathTreeKey& other) const {
+        return origin == other.origin && metric == other.metric
+            && avoidNodes == other.avoidNodes && avoidSegments == other.avoidSegments;
+    }
+
+    bool operator<(const PathTreeKey& other) const {
+        return std::tie(origin, metric, avoidNodes, avoidSegments) < std::tie(other.origin, other.metric, other.avoidNodes, other.avoidSegments);
+    }
+};
+
+/**
+ * @brief Bounded LRU cache of complete shortest path trees (dist + path arrays indexed by vertex index).
+ *
+ * A tree is stored right after a search and can later be written back into the vertices, after which getPath
+ * works exactly as if the search had just been run, for any destination.
+ * All methods are thread-safe.
+ */
+template <class T>
+class ShortestPathTreeCache
+{
+public:
+    static const unsigned DEFAULT_CAPACITY = 64;
+
+    explicit ShortestPathTreeCache(unsigned capacity = DEFAULT_CAPACITY) : capacity(capacity) {}
+
+    /**
+     * @brief Builds the key of a tree from its origin, metric and restrictions.
+     */
+    static PathTreeKey makeKey(Vertex<T>* origin, int metric, const std::vector<Vertex<T>*>& nAvoid, const std::vector<Edge<T>*>& eAvoid);
+
+    /**
+     * @brief If the tree is cached, writes its dist and path values back into the vertices of g.
+     *
+     * @return true on a hit, false otherwise.
+     *
+     * O(|V|) time complexity.
+     */
+    bool restore(Graph<T>* g, const PathTreeKey& key);
+
+    /**
+     * @brief Stores the tree currently held by the vertices of g, evicting the least recently used tree if needed.
+     *
+     * O(|V|) time complexity.
+     */
+    void store(Graph<T>* g, const PathTreeKey& key);
+
+    /**
+     * @brief Keeps the cache consistent after the weight of an edge (and of its reverse) changed for the given metric.
+     *
+     * Trees stay cached when the change cannot affect them: a weight that went up on an edge outside the tree,
+     * or one that went down without reaching any distance in the tree. Every other tree of that metric is dropped.
+     *
+     * O(1) time complexity per cached tree.
+     */
+    void repair(Edge<T>* edge, int metric, double oldWeight, double newWeight);
+
+    /**
+     * @brief Drops every tree, used whenever the graph changes. Counters are kept.
+     */
+    void clear();
+
+    unsigned long getHits() const { return hits; }
+    unsigned long getMisses() const { return misses; }
+    unsigned size() const;
+
+private:
+    struct Tree
+    {
+        PathTreeKey key;
+        std::vector<double> dist;
+        std::vector<Edge<T>*> path;
+    };
+
+    std::list<Tree> trees; // most recently used at the front
+    unsigned capacity;
+    std::atomic<unsigned long> hits{0}, misses{0};
+    mutable std::mutex mtx;
+};
+
+template <class T>
+const unsigned ShortestPathTreeCache<T>::DEFAULT_CAPACITY;
+
+template <class T>
+PathTreeKey ShortestPathTreeCache<T>::makeKey(Vertex<T>* origin, int metric, const std::vector<Vertex<T>*>& nAvoid, const std::vector<Edge<T>*>& eAvoid) {
+    PathTreeKey key;
+    key.origin = origin->getIndex();
+    key.metric = metric;
+    canonicalRestrictions(nAvoid, eAvoid, key.avoidNodes, key.avoidSegments);
+    return key;
+}
+
+template <class T>
+bool ShortestPathTreeCache<T>::restore(Graph<T>* g, const PathTreeKey& key) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto it = trees.begin(); it != trees.end(); it++) {
+        if (it->key == key) {
+            trees.splice(trees.begin(), trees, it);
+            Tree& tree = trees.front();
+            for (Vertex<T>* v : g->getVertexSet()) {
+                v->setDist(tree.dist[v->getIndex()]);
+                v->setPath(tree.path[v->getIndex()]);
+            }
+            hits++;
+            return true;
+        }
+    }
+    misses++;
+    return false;
+}
+
+template <class T>
+void ShortestPathTreeCache<T>::store(Graph<T>* g, const PathTreeKey& key) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (capacity == 0) return;
+    Tree tree;
+    tree.key = key;
+    std::vector<Vertex<T>*> vertexSet = g->getVertexSet();
+    tree.dist.resize(vertexSet.size());
+    tree.path.resize(vertexSet.size());
+    for (Vertex<T>* v : vertexSet) {
+        tree.dist[v->getIndex()] = v->getDist();
+        tree.path[v->getIndex()] = v->getPath();
+    }
+    for (auto it = trees.begin(); it != trees.end(); it++) {
+        if (it->key == key) {
+            trees.erase(it);
+            break;
+        }
+    }
+    trees.push_front(std::move(tree));
+    while (trees.size() > capacity) trees.pop_back();
+}
+
+template <class T>
+void ShortestPathTreeCache<T>::repair(Edge<T>* edge, int metric, double oldWeight, double newWeight) {
+    if (oldWeight == newWeight) return;
+    std::lock_guard<std::mutex> lock(mtx);
+    auto affects = [&](const Tree& tree, Edge<T>* e) {
+        if (e == nullptr) return false;
+        int u = e->getOrig()->getIndex(), v = e->getDest()->getIndex();
+        if (tree.path[v] == e) return true;
+        return newWeight < oldWeight && tree.dist[u] != INF && tree.dist[u] + newWeight <= tree.dist[v];
+    };
+    auto it = trees.begin();
+    while (it != trees.end()) {
+        if (it->key.metric == metric && (affects(*it, edge) || affects(*it, edge->getReverse()))) {
+            it = trees.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+}
+
+template <class T>
+void ShortestPathTreeCache<T>::clear() {
+    std::lock_guard<std::mutex> lock(mtx);
+    trees.clear();
+}
+
+template <class T>
+unsigned ShortestPathTreeCache<T>::size() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return trees.size();
+}
+
+#endif //SHORTEST_PATH_TREE_CACHE_H
@@ -0,0 +1,148 @@
+#ifndef TRAVEL_TIME_PROFILES_H
+#define TRAVEL_TIME_PROFILES_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "Graph.h"
+
+//* Length of a profile in minutes, departure times are taken modulo it
+#ifndef PROFILE_PERIOD
+#define PROFILE_PERIOD 1440
+#endif
+
+/**
+ * @brief Time dependent drive times: piecewise linear travel time profiles for some of the edges of a graph.
+ *
+ * A profile is a list of breakpoints (departure, travel time), with departures in minutes after midnight in
+ * increasing order. Between two breakpoints the travel time is interpolated linearly, and the day wraps around,
+ * so after the last breakpoint it goes towards the first one of the next day. Every profile has the FIFO property
+ * (entering an edge later never gets out of it earlier, so no slope is below -1), which add checks, and that
+ * keeps a time dependent dijkstra exact.
+ *
+ * Profiles are shared: every edge with the same breakpoints points to a single copy of them, so an edge costs one
+ * index on top of the scalar graph, and edges without a profile keep their fixed drive time.
+ */
+template <class T>
+class TravelTimeProfiles
+{
+public:
+    struct Breakpoint
+    {
+        float departure;
+        float travelTime;
+
+        bool operator<(const Breakpoint& other) const {
+            return departure < other.departure || (departure == other.departure && travelTime < other.travelTime);
+        }
+    };
+
+    /**
+     * @brief Gives an edge a profile, replacing the one it had.
+     *
+     * @param points The breakpoints, sorted by departure.
+     * @return false, leaving the edge unchanged, if there are no breakpoints, the departures are not increasing or
+     * out of [0, PROFILE_PERIOD), a travel time is negative or the profile is not FIFO.
+     *
+     * O(B log P) time complexity, where B is the amount of breakpoints and P the amount of distinct profiles.
+     */
+    bool add(const Edge<T>* e, const std::vector<Breakpoint>& points) {
+        if (!isValid(points)) return false;
+        auto it = ids.find(points);
+        uint32_t id;
+        if (it != ids.end()) {
+            id = it->second;
+        }
+        else {
+            if (offsets.empty()) offsets.assign(2, 0); // profile 0 is the empty one, used by edges without a profile
+            id = offsets.size() - 1;
+            breakpoints.insert(breakpoints.end(), points.begin(), points.end());
+            offsets.push_back(breakpoints.size());
+            ids.emplace(points, id);
+        }
+        if ((size_t)e->getIndex() >= edgeProfile.size()) edgeProfile.resize(e->getIndex() + 1, 0);
+        edgeProfile[e->getIndex()] = id;
+        return true;
+    }
+
+    //* The edge goes back to its fixed drive time, the shared breakpoints are kept
+    void remove(const Edge<T>* e) {
+        if ((size_t)e->getIndex() < edgeProfile.size()) edgeProfile[e->getIndex()] = 0;
+    }
+
+    bool hasProfile(const Edge<T>* e) const {
+        return profileOf(e) != 0;
+    }
+
+    //* Amount of distinct profiles
+    size_t size() const {
+        return ids.size();
+    }
+
+    void clear() {
+        edgeProfile.clear();
+        offsets.clear();
+        breakpoints.clear();
+        ids.clear();
+    }
+
+    /**
+     * @brief Time it takes to drive through an edge entering it at a given time.
+     *
+     * @param departure Minutes after midnight of the first day, can go past PROFILE_PERIOD.
+     * @return The travel time from the profile of the edge, or its fixed drive time if it has none.
+     *
+     * O(log B) time complexity, where B is the amount of breakpoints of the profile.
+     */
+    double travelTime(const Edge<T>* e, double departure) const {
+        uint32_t id = profileOf(e);
+        if (id == 0) return e->getDriveTime();
+        const Breakpoint* first = breakpoints.data() + offsets[id];
+        const Breakpoint* last = breakpoints.data() + offsets[id + 1];
+        double t = std::fmod(departure, PROFILE_PERIOD);
+        if (t < 0) t += PROFILE_PERIOD;
+
+        //* the breakpoints around t, the ones of the day before or after when t is outside of them
+        const Breakpoint* next = std::upper_bound(first, last, t, [](double time, const Breakpoint& b) { return time < b.departure; });
+        const Breakpoint* previous = (next == first) ? last - 1 : next - 1;
+        double previousDeparture = previous->departure, nextDeparture;
+        if (next == first) previousDeparture -= PROFILE_PERIOD;
+        if (next == last) {
+            next = first;
+            nextDeparture = first->departure + PROFILE_PERIOD;
+        }
+        else {
+            nextDeparture = next->departure;
+        }
+        double fraction = (t - previousDeparture) / (nextDeparture - previousDeparture);
+        return previous->travelTime + fraction * (next->travelTime - previous->travelTime);
+    }
+
+private:
+    std::vector<uint32_t> edgeProfile; // profile of every edge by edge index, 0 for none
+    std::vector<uint32_t> offsets;     // breakpoints of profile p are [offsets[p], offsets[p + 1])
+    std::vector<Breakpoint> breakpoints;
+    std::map<std::vector<Breakpoint>, uint32_t> ids; // to share identical profiles
+
+    uint32_t profileOf(const Edge<T>* e) const {
+        return (size_t)e->getIndex() < edgeProfile.size() ? edgeProfile[e->getIndex()] : 0;
+    }
+
+    static bool isValid(const std::vector<Breakpoint>& points) {
+        if (points.empty()) return false;
+        for (size_t i = 0; i < points.size(); i++) {
+            const Breakpoint& b = points[i];
+            if (!(b.departure >= 0 && b.departure < PROFILE_PERIOD && b.travelTime >= 0)) return false;
+            //* FIFO: arriving from the next breakpoint (the first one of the next day after the last) is never earlier
+            const Breakpoint& next = points[(i + 1) % points.size()];
+            double nextDeparture = next.departure + (i + 1 == points.size() ? PROFILE_PERIOD : 0);
+            if (i + 1 < points.size() && next.departure <= b.departure) return false;
+            if (nextDeparture + next.travelTime < b.departure + b.travelTime) return false;
+        }
+        return true;
+    }
+};
+
+#endif //TRAVEL_TIME_PROFILES_H
@@ -0,0 +1,119 @@
+#include "BidirectionalSearch.h"
+#include "Metrics.h"
+#include "QueryBudget.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+using namespace std;
+
+double BidirectionalSearch::query(Graph<int>* g, Vertex<int>* origin, Vertex<int>* dest, Distance d, const RestrictionMask* mask, vector<Edge<int>*>& edges) {
+    edges.clear();
+    if (origin == nullptr || dest == nullptr) return -1;
+    if (origin == dest) return 0;
+    int s = origin->getIndex(), t = dest->getIndex();
+    //* dijkstra never expands a restricted origin
+    if (mask != nullptr && mask->stopsAt(s)) return -1;
+
+    if (g != graph || vertices.size() != (size_t)g->getCodeVertex()) {
+        graph = g;
+        vertices = g->getVertexSet();
+    }
+    size_t n = vertices.size();
+    if (forwardDist.size() != n) {
+        forwardDist.assign(n, INF);
+        backwardDist.assign(n, INF);
+        forwardEdge.assign(n, nullptr);
+        backwardEdge.assign(n, nullptr);
+        touched.clear();
+    }
+    for (int v : touched) {
+        forwardDist[v] = backwardDist[v] = INF;
+        forwardEdge[v] = backwardEdge[v] = nullptr;
+    }
+    touched.clear();
+
+    //* pinned for the whole search, updates published meanwhile are not seen
+    shared_ptr<const EdgeWeights> weights = g->getWeights();
+    auto weight = [d, &weights](Edge<int>* e) { return d == Distance::drive ? weights->driveTime(e->getIndex()) : weights->walkTime(e->getIndex()); };
+    //* an edge can be used if its tail can be expanded and neither it nor its head are blocked,
+    //* which leaves skipped vertices as possible ends of the path only, just like in dijkstra
+    auto usable = [mask](Edge<int>* e) {
+        return mask == nullptr || !(mask->stopsAt(e->getOrig()->getIndex()) || mask->excludes(e->getIndex(), e->getDest()->getIndex()));
+    };
+
+    typedef pair<double, int> Item;
+    priority_queue<Item, vector<Item>, greater<Item>> forward, backward;
+    forwardDist[s] = 0;
+    backwardDist[t] = 0;
+    touched.push_back(s);
+    touched.push_back(t);
+    forward.push(Item(0, s));
+    backward.push(Item(0, t));
+
+    double best = INF;
+    int meet = -1;
+    uint64_t settled = 0, relaxed = 0;
+    QueryBudget* budget = QueryBudget::active();
+    while (!forward.empty() && !backward.empty()) {
+        if (forward.top().first + backward.top().first >= best) break;
+        bool isForward = forward.top().first <= backward.top().first;
+        priority_queue<Item, vector<Item>, greater<Item>>& q = isForward ? forward : backward;
+        vector<double>& dist = isForward ? forwardDist : backwardDist;
+        vector<double>& other = isForward ? backwardDist : forwardDist;
+        vector<Edge<int>*>& parent = isForward ? forwardEdge : backwardEdge;
+        Item item = q.top();
+        q.pop();
+        int v = item.second;
+        if (item.first > dist[v]) continue; // outdated entry
+        if (budget != nullptr && !budget->settle()) break;
+        settled++;
+
+        Vertex<int>* vertex = vertices[v];
+        for (Edge<int>* e : isForward ? vertex->getAdj() : vertex->getIncoming()) {
+            double w = weight(e);
+            if (w == INF || !usable(e)) continue;
+            int u = (isForward ? e->getDest() : e->getOrig())->getIndex();
+            if (dist[v] + w >= dist[u]) continue;
+            relaxed++;
+            if (forwardDist[u] == INF && backwardDist[u] == INF) touched.push_back(u);
+            dist[u] = dist[v] + w;
+            parent[u] = e;
+            q.push(Item(dist[u], u));
+            if (other[u] != INF && dist[u] + other[u] < best) {
+                best = dist[u] + other[u];
+                meet = u;
+            }
+        }
+    }
+    Metrics::add(Metrics::searches);
+    Metrics::add(Metrics::settledVertices, settled);
+    Metrics::add(Metrics::relaxedEdges, relaxed);
+    if (meet == -1) return -1;
+
+    for (int v = meet; v != s; v = forwardEdge[v]->getOrig()->getIndex()) edges.push_back(forwardEdge[v]);
+    reverse(edges.begin(), edges.end());
+    for (int v = meet; v != t; v = backwardEdge[v]->getDest()->getIndex()) edges.push_back(backwardEdge[v]);
+    return best;
+}
+
+double BidirectionalSearch::queryThrough(Graph<int>* g, Vertex<int>* origin, const vector<Vertex<int>*>& stops, Vertex<int>* dest, Distance d, const RestrictionMask* mask, vector<int>& res) {
+    res.clear();
+    if (origin == nullptr) return -1;
+    res.push_back(origin->getInfo());
+    double total = 0;
+    vector<Edge<int>*> leg;
+    Vertex<int>* from = origin;
+    for (size_t i = 0; i <= stops.size(); i++) {
+        Vertex<int>* to = (i < stops.size()) ? stops[i] : dest;
+        double dist = query(g, from, to, d, mask, leg);
+        if (dist == -1) {
+            res.clear();
+            return -1;
+        }
+        for (Edge<int>* e : leg) res.push_back(e->getDest()->getInfo());
+        total += dist;
+        from = to;
+    }
+    return total;
+}
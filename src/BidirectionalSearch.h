@@ -0,0 +1,59 @@
+#ifndef BIDIRECTIONAL_SEARCH_H
+#define BIDIRECTIONAL_SEARCH_H
+
+#include <vector>
+#include <Graph.h>
+#include "ShortestPathAlgorithms.h"
+
+/**
+ * @brief Point to point shortest paths over a Graph<int> with a bidirectional Dijkstra.
+ *
+ * A forward search follows outgoing edges from the origin and a backward search follows incoming edges from the
+ * destination, so directed graphs are handled correctly. The search with the smallest key advances, and both stop
+ * as soon as their keys add up to the best meeting point found, which is then proven optimal.
+ *
+ * Restrictions follow the same rules as dijkstra with a RestrictionMask: blocked vertices and edges are never used,
+ * skipped vertices may only be the ends of the path.
+ *
+ * Distances and paths are kept in internal buffers indexed by vertex index, the graph itself is not changed,
+ * so a single instance must not be queried by several threads at once.
+ */
+class BidirectionalSearch
+{
+public:
+    /**
+     * @brief Shortest path from origin to dest.
+     *
+     * @param g The graph to search.
+     * @param origin Pointer to the origin vertex.
+     * @param dest Pointer to the destination vertex.
+     * @param distance Decides between using Driving edges or Walking edges.
+     * @param mask Restrictions of the search, nullptr if none.
+     * @param edges Filled with the edges of the path, in order, empty if origin and dest are the same.
+     * @return The total distance of the path, -1 if there is no path.
+     *
+     * O((S + E_S) log S) time complexity, where S is the amount of vertices settled by both searches and E_S their edges.
+     */
+    double query(Graph<int>* g, Vertex<int>* origin, Vertex<int>* dest, Distance distance, const RestrictionMask* mask, std::vector<Edge<int>*>& edges);
+
+    /**
+     * @brief Shortest path from origin to dest that goes through every stop in the given order,
+     * as one point to point search per leg.
+     *
+     * @param stops The vertices to go through, in order.
+     * @param res Filled with the ids of the vertices on the path, from origin to dest, each stop appearing once.
+     * @return The total distance of the path, -1 if one of the legs has no path.
+     *
+     * Same complexity as |stops| + 1 calls to query.
+     */
+    double queryThrough(Graph<int>* g, Vertex<int>* origin, const std::vector<Vertex<int>*>& stops, Vertex<int>* dest, Distance distance, const RestrictionMask* mask, std::vector<int>& res);
+
+private:
+    Graph<int>* graph = nullptr;
+    std::vector<Vertex<int>*> vertices;
+    std::vector<double> forwardDist, backwardDist;
+    std::vector<Edge<int>*> forwardEdge, backwardEdge;
+    std::vector<int> touched;
+};
+
+#endif //BIDIRECTIONAL_SEARCH_H
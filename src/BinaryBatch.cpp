@@ -0,0 +1,394 @@
+#include "BinaryBatch.h"
+#include "CLInterface.h"
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The binary batch formats are little endian and are read in place"
+#endif
+
+namespace BinaryBatch
+{
+
+template <class T>
+static void appendRaw(string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//* Pads with zeros until the bytes written since start are a multiple of alignment
+static void padFrom(string& out, size_t start, size_t alignment) {
+    out.append((alignment - (out.size() - start) % alignment) % alignment, '\0');
+}
+
+//* Writes the BinaryRecord of a new record, its size is filled in by endRecord
+static size_t beginRecord(string& out, RecordKind kind) {
+    size_t start = out.size();
+    BinaryRecord record = { kind, 0 };
+    appendRaw(out, record);
+    return start;
+}
+
+static void endRecord(string& out, size_t start) {
+    padFrom(out, start, 8);
+    uint32_t size = out.size() - start;
+    memcpy(&out[start + offsetof(BinaryRecord, size)], &size, sizeof(size));
+}
+
+//* Vertex with the given index, nullptr if there is none
+static Vertex<int>* vertexAt(const vector<Vertex<int>*>& vertices, uint32_t index) {
+    return index < vertices.size() ? vertices[index] : nullptr;
+}
+
+Reader::Reader(const string& filename, const char* magic) : file(filename) {
+    if (!file.isOpen() || file.size() < sizeof(BinaryHeader)) return;
+    memcpy(&header, file.data(), sizeof(BinaryHeader));
+    valid = memcmp(header.magic, magic, sizeof(header.magic)) == 0 && header.version == version;
+}
+
+bool Reader::next(RecordView& record) {
+    if (!valid) return false;
+    if (records == header.recordCount) {
+        complete = true;
+        return false;
+    }
+    if (file.size() - offset < sizeof(BinaryRecord)) return false;
+    BinaryRecord r;
+    memcpy(&r, file.data() + offset, sizeof(BinaryRecord));
+    if (r.size < sizeof(BinaryRecord) || r.size % 8 != 0 || r.size > file.size() - offset) return false;
+    record.kind = r.kind;
+    record.body = file.data() + offset + sizeof(BinaryRecord);
+    record.size = r.size - sizeof(BinaryRecord);
+    offset += r.size;
+    records++;
+    return true;
+}
+
+bool hasMagic(const string& filename, const char* magic) {
+    ifstream file(filename, ios::binary);
+    char start[4];
+    return file.read(start, sizeof(start)) && memcmp(start, magic, sizeof(start)) == 0;
+}
+
+bool readQuery(const RecordView& record, QueryView& view) {
+    if (record.size < sizeof(BinaryQuery)) return false;
+    memcpy(&view.query, record.body, sizeof(BinaryQuery));
+    const BinaryQuery& q = view.query;
+    uint64_t nameBytes = ((uint64_t)q.nameLength + 3) / 4 * 4;
+    uint64_t listBytes = 4 * ((uint64_t)q.avoidNodeCount + 2 * (uint64_t)q.avoidSegmentCount + q.includeCount);
+    if (sizeof(BinaryQuery) + nameBytes + listBytes > record.size) return false;
+    const char* name = record.body + sizeof(BinaryQuery);
+    view.name.assign(name, q.nameLength);
+    view.avoidNodes = reinterpret_cast<const uint32_t*>(name + nameBytes);
+    view.avoidSegments = view.avoidNodes + q.avoidNodeCount;
+    view.include = view.avoidSegments + 2 * (size_t)q.avoidSegmentCount;
+    return true;
+}
+
+void appendHeader(string& out, const char* magic, uint32_t vertexCount, uint32_t recordCount) {
+    BinaryHeader header;
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = version;
+    header.vertexCount = vertexCount;
+    header.recordCount = recordCount;
+    appendRaw(out, header);
+}
+
+void appendQuery(string& out, RecordKind kind, uint32_t flags, const string& name, Vertex<int>* source, Vertex<int>* destination,
+    double maxWalkTime, double departure, int64_t deadline, int64_t maxSettled, const vector<Vertex<int>*>& nAvoid, const vector<Edge<int>*>& eAvoid, const vector<Vertex<int>*>& include) {
+    size_t start = beginRecord(out, kind);
+    BinaryQuery query = {};
+    query.flags = flags;
+    query.source = source->getIndex();
+    query.destination = destination->getIndex();
+    query.nameLength = name.size();
+    query.avoidNodeCount = nAvoid.size();
+    query.avoidSegmentCount = eAvoid.size();
+    query.includeCount = include.size();
+    query.maxWalkTime = maxWalkTime;
+    query.departure = departure;
+    query.deadline = deadline;
+    query.maxSettled = maxSettled;
+    appendRaw(out, query);
+    out += name;
+    padFrom(out, start, 4);
+    for (Vertex<int>* v : nAvoid) appendRaw(out, (uint32_t)v->getIndex());
+    for (Edge<int>* e : eAvoid) {
+        appendRaw(out, (uint32_t)e->getOrig()->getIndex());
+        appendRaw(out, (uint32_t)e->getDest()->getIndex());
+    }
+    for (Vertex<int>* v : include) appendRaw(out, (uint32_t)v->getIndex());
+    endRecord(out, start);
+}
+
+void appendUpdate(string& out, Edge<int>* e, double driveTime, double walkTime) {
+    size_t start = beginRecord(out, update);
+    BinaryUpdate body = { (uint32_t)e->getOrig()->getIndex(), (uint32_t)e->getDest()->getIndex(), driveTime, walkTime };
+    appendRaw(out, body);
+    endRecord(out, start);
+}
+
+void appendEngine(string& out, uint32_t engineId) {
+    size_t start = beginRecord(out, engine);
+    BinaryEngine body = { engineId, 0 };
+    appendRaw(out, body);
+    endRecord(out, start);
+}
+
+void appendResult(string& out, const string& name, const QueryResult& result, const unordered_map<int, int>& indices) {
+    static const RecordKind kinds[] = { independentResult, restrictedResult, ecoResult, paretoResult };
+    size_t start = beginRecord(out, kinds[result.kind]);
+    BinaryResult body = {};
+    body.flags = (result.found ? (uint32_t)found : 0u) | (result.aproximate ? (uint32_t)aproximated : 0u) | ((uint32_t)result.stopped << stoppedShift);
+    body.source = result.source->getIndex();
+    body.destination = result.destination->getIndex();
+    body.nameLength = name.size();
+    body.routeCount = result.routes.size();
+    body.listed = result.listed;
+    body.maxWalkTime = result.maxWalkTime;
+    body.departure = result.departure;
+    appendRaw(out, body);
+    out += name;
+    padFrom(out, start, 8);
+    for (const QueryResult::Route& route : result.routes) {
+        BinaryRoute header = {};
+        header.number = route.number;
+        header.parking = route.parking != nullptr ? route.parking->getIndex() : noVertex;
+        header.drivePathLength = route.drivePath.size();
+        header.walkPathLength = route.walkPath.size();
+        header.driveTime = route.driveTime;
+        header.walkTime = route.walkTime;
+        appendRaw(out, header);
+        for (int id : route.drivePath) appendRaw(out, (uint32_t)indices.at(id));
+        for (int id : route.walkPath) appendRaw(out, (uint32_t)indices.at(id));
+        padFrom(out, start, 8);
+    }
+    endRecord(out, start);
+}
+
+void appendRoute(string& out, const string& name, uint32_t source, uint32_t destination, double driveTime, const vector<int>& path) {
+    size_t start = beginRecord(out, restrictedResult);
+    BinaryResult body = {};
+    body.source = source;
+    body.destination = destination;
+    body.nameLength = name.size();
+    body.routeCount = 1;
+    body.departure = -1;
+    appendRaw(out, body);
+    out += name;
+    padFrom(out, start, 8);
+    BinaryRoute header = {};
+    header.parking = noVertex;
+    header.drivePathLength = path.size();
+    header.driveTime = driveTime;
+    appendRaw(out, header);
+    for (int index : path) appendRaw(out, (uint32_t)index);
+    padFrom(out, start, 8);
+    endRecord(out, start);
+}
+
+void appendInvalid(string& out, const string& name) {
+    size_t start = beginRecord(out, invalidQuery);
+    BinaryResult body = {};
+    body.departure = -1;
+    body.source = noVertex;
+    body.destination = noVertex;
+    body.nameLength = name.size();
+    appendRaw(out, body);
+    out += name;
+    endRecord(out, start);
+}
+
+//* Writes vertices as comma separated ids, false if some index is not a vertex
+static bool writeVertices(const uint32_t* indices, uint32_t count, const vector<Vertex<int>*>& vertices, OutputSink& out) {
+    for (uint32_t i = 0; i < count; i++) {
+        Vertex<int>* v = vertexAt(vertices, indices[i]);
+        if (v == nullptr) return false;
+        if (i > 0) out << ',';
+        out << v->getInfo();
+    }
+    return true;
+}
+
+//* Update and engine lines, written the same way for requests and results
+static bool writeChange(const RecordView& record, const vector<Vertex<int>*>& vertices, OutputSink& out) {
+    if (record.kind == update) {
+        if (record.size < sizeof(BinaryUpdate)) return false;
+        BinaryUpdate body;
+        memcpy(&body, record.body, sizeof(BinaryUpdate));
+        Vertex<int>* origin = vertexAt(vertices, body.origin);
+        Vertex<int>* destination = vertexAt(vertices, body.destination);
+        if (origin == nullptr || destination == nullptr) return false;
+        out << "Update:(" << origin->getInfo() << ',' << destination->getInfo() << "),";
+        if (body.driveTime == INF) out << 'X';
+        else out << body.driveTime;
+        out << ',' << body.walkTime << '\n';
+    }
+    else {
+        if (record.size < sizeof(BinaryEngine)) return false;
+        BinaryEngine body;
+        memcpy(&body, record.body, sizeof(BinaryEngine));
+        out << "Engine:";
+        if (body.engine == CLInterface::Engine::customizableCH) out << "cch";
+        else if (body.engine == CLInterface::Engine::multiLevelOverlay) out << "crp";
+        else out << "dijkstra";
+        out << '\n';
+    }
+    out << '\n';
+    return true;
+}
+
+static bool writeRequest(const RecordView& record, const vector<Vertex<int>*>& vertices, OutputSink& out) {
+    if (record.kind == update || record.kind == engine) return writeChange(record, vertices, out);
+    if (record.kind != drivingQuery && record.kind != drivingWalkingQuery && record.kind != drivingWalkingParetoQuery) return false;
+    QueryView view;
+    if (!readQuery(record, view)) return false;
+    const BinaryQuery& q = view.query;
+    Vertex<int>* source = vertexAt(vertices, q.source);
+    Vertex<int>* destination = vertexAt(vertices, q.destination);
+    if (source == nullptr || destination == nullptr) return false;
+    bool walking = record.kind == drivingWalkingQuery;
+    bool pareto = record.kind == drivingWalkingParetoQuery;
+
+    out << '#' << view.name << '\n';
+    out << "Mode:" << (walking ? "driving-walking" : pareto ? "driving-walking-pareto" : "driving") << '\n';
+    out << "Source:" << source->getInfo() << '\n';
+    out << "Destination:" << destination->getInfo() << '\n';
+    if (!walking && !pareto && q.departure >= 0) out << "Departure:" << q.departure << '\n';
+    if (q.deadline >= 0) out << "Deadline:" << to_string(q.deadline) << '\n';
+    if (q.maxSettled >= 0) out << "MaxSettled:" << to_string(q.maxSettled) << '\n';
+    if (walking || pareto || (q.flags & restricted)) {
+        if (walking) out << "MaxWalkTime:" << q.maxWalkTime << '\n';
+        out << "AvoidNodes:";
+        if (!writeVertices(view.avoidNodes, q.avoidNodeCount, vertices, out)) return false;
+        out << '\n' << "AvoidSegments:";
+        for (uint32_t i = 0; i < q.avoidSegmentCount; i++) {
+            if (i > 0) out << ',';
+            out << '(';
+            if (!writeVertices(view.avoidSegments + 2 * i, 2, vertices, out)) return false;
+            out << ')';
+        }
+        out << '\n';
+        //* pareto queries end after the lists
+        if (!walking && !pareto) {
+            if (q.flags & anyOrder) out << "IncludeNodesAnyOrder:";
+            else if (q.includeCount > 1) out << "IncludeNodes:";
+            else out << "IncludeNode:";
+            if (!writeVertices(view.include, q.includeCount, vertices, out)) return false;
+            out << '\n';
+        }
+        else if (walking && (q.flags & aproximate)) {
+            out << "Aproximate" << '\n';
+        }
+        //* the line after MaxWalkTime and the lists is read as the optional Aproximate, an empty one there does not
+        //* end the restrictions of the query (the avoid lists would carry over to the next one), a second one does
+        else if (walking) {
+            out << '\n';
+        }
+    }
+    out << '\n';
+    return true;
+}
+
+//* Reads a path of count vertices as ids, false if some index is not a vertex
+static bool readPath(const uint32_t* indices, uint32_t count, const vector<Vertex<int>*>& vertices, vector<int>& path) {
+    for (uint32_t i = 0; i < count; i++) {
+        Vertex<int>* v = vertexAt(vertices, indices[i]);
+        if (v == nullptr) return false;
+        path.push_back(v->getInfo());
+    }
+    return true;
+}
+
+static bool writeResult(const RecordView& record, const vector<Vertex<int>*>& vertices, OutputSink& out) {
+    if (record.kind == update || record.kind == engine) return writeChange(record, vertices, out);
+    if (record.kind < independentResult || record.kind > paretoResult || record.kind == drivingWalkingParetoQuery || record.size < sizeof(BinaryResult)) return false;
+    BinaryResult body;
+    memcpy(&body, record.body, sizeof(BinaryResult));
+    size_t offset = sizeof(BinaryResult) + ((uint64_t)body.nameLength + 7) / 8 * 8;
+    if (offset > record.size) return false;
+    out << '#';
+    out.write(record.body + sizeof(BinaryResult), body.nameLength);
+    out << '\n';
+    if (record.kind == invalidQuery) {
+        out << "Invalid query record" << '\n' << '\n';
+        return true;
+    }
+
+    QueryResult result;
+    result.kind = record.kind == paretoResult ? QueryResult::pareto : (QueryResult::Kind)(record.kind - independentResult);
+    result.source = vertexAt(vertices, body.source);
+    result.destination = vertexAt(vertices, body.destination);
+    result.found = body.flags & found;
+    result.aproximate = body.flags & aproximated;
+    result.maxWalkTime = body.maxWalkTime;
+    result.departure = body.departure;
+    result.listed = body.listed;
+    result.stopped = (QueryBudget::Stop)((body.flags & stopped) >> stoppedShift);
+    if (result.source == nullptr || result.destination == nullptr) return false;
+    if (result.stopped != QueryBudget::none) {
+        if (body.routeCount != 0) return false;
+    }
+    //* an independent result always has both routes and a restricted one its single route
+    else if ((result.kind == QueryResult::independent && body.routeCount != 2) || (result.kind == QueryResult::restricted && body.routeCount != 1)) return false;
+    for (uint32_t r = 0; r < body.routeCount; r++) {
+        if (record.size - offset < sizeof(BinaryRoute)) return false;
+        BinaryRoute header;
+        memcpy(&header, record.body + offset, sizeof(BinaryRoute));
+        offset += sizeof(BinaryRoute);
+        uint64_t pathBytes = 4 * ((uint64_t)header.drivePathLength + header.walkPathLength);
+        if (record.size - offset < pathBytes) return false;
+        const uint32_t* path = reinterpret_cast<const uint32_t*>(record.body + offset);
+        offset += (pathBytes + 7) / 8 * 8;
+
+        result.routes.emplace_back();
+        QueryResult::Route& route = result.routes.back();
+        route.number = header.number;
+        route.driveTime = header.driveTime;
+        route.walkTime = header.walkTime;
+        if (result.kind == QueryResult::eco || result.kind == QueryResult::pareto) {
+            route.parking = vertexAt(vertices, header.parking);
+            if (route.parking == nullptr) return false;
+        }
+        if (!readPath(path, header.drivePathLength, vertices, route.drivePath)) return false;
+        if (!readPath(path + header.drivePathLength, header.walkPathLength, vertices, route.walkPath)) return false;
+    }
+    if (result.kind == QueryResult::eco && result.found && result.routes.size() != 1) return false;
+
+    result.writeText(out);
+    //* a single empty line after every result, eco results are the only ones that can end without it
+    bool endsEmpty = result.kind != QueryResult::eco || (result.aproximate && !result.found && result.stopped == QueryBudget::none);
+    if (!endsEmpty) out << '\n';
+    return true;
+}
+
+int toText(const string& inputFileName, const string& outputFileName, Graph<int>* g) {
+    bool requests = hasMagic(inputFileName, requestMagic);
+    Reader reader(inputFileName, requests ? requestMagic : resultMagic);
+    if (!reader.isValid() || reader.getHeader().vertexCount != (uint32_t)g->getCodeVertex()) {
+        cerr << "Not a binary requests or results file for this graph: " << inputFileName << '\n';
+        return 1;
+    }
+    vector<Vertex<int>*> vertices = g->getVertexSet();
+    ofstream file(outputFileName);
+    OutputSink out(file);
+    RecordView record;
+    unsigned count = 0;
+    while (reader.next(record)) {
+        bool written = requests ? writeRequest(record, vertices, out) : writeResult(record, vertices, out);
+        if (!written) {
+            cerr << "Invalid record " << count << " in " << inputFileName << '\n';
+            return 1;
+        }
+        count++;
+    }
+    if (!reader.isComplete()) {
+        cerr << "Binary file ends after record " << count << " of " << reader.getHeader().recordCount << ": " << inputFileName << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,254 @@
+#ifndef BINARY_BATCH_H
+#define BINARY_BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <Graph.h>
+#include "MappedFile.h"
+#include "QueryResult.h"
+
+/**
+ * @brief Binary formats for batches of queries and their results, meant for other programs instead of people.
+ *
+ * Both files are a BinaryHeader followed by records, each one a BinaryRecord (kind and total size) and its body.
+ * Every number is little endian, vertices are given by their index in the graph (the line of Locations.csv they
+ * come from, counting from 0) and every record starts at a multiple of 8 bytes, so a mapped file can be read in
+ * place with no parsing and no copies.
+ *
+ * Requests file: a request record per query, update or engine change, in the same order the text format has them.
+ * - Query (drivingQuery, drivingWalkingQuery or drivingWalkingParetoQuery): BinaryQuery, the name padded to 4 bytes, then
+ *   avoidNodeCount vertices, avoidSegmentCount pairs of vertices and includeCount vertices, all uint32_t.
+ * - Update: BinaryUpdate, the segment by its two vertices and the new times, INF drive time if it can't be driven.
+ * - Engine: BinaryEngine, with a CLInterface::Engine.
+ *
+ * Results file: one record for each request record, in the same order.
+ * - Query result (independentResult, restrictedResult, ecoResult or paretoResult): BinaryResult, the name padded to 8 bytes, then
+ *   routeCount routes, each a BinaryRoute followed by its driving and walking paths (uint32_t vertices) padded to
+ *   8 bytes. Routes hold the same as in QueryResult.
+ *   A query stopped by its budget has the reason in the stopped flags and no routes.
+ * - invalidQuery: a BinaryResult with no routes, for a query record that refers to vertices or segments that don't exist
+ *   (or, answered from a partitioned graph, a query that needs more than its shortest driving route).
+ * - Update and engine records are copied from the requests.
+ *
+ * Query names are kept as they were after the '#', so converting to text and back gives the same file.
+ */
+namespace BinaryBatch
+{
+    const char requestMagic[4] = { 'R', 'Q', 'B', '1' };
+    const char resultMagic[4] = { 'R', 'S', 'B', '1' };
+    const uint32_t version = 3; //* 2 added the departure times, 3 the limits of each query
+    const uint32_t noVertex = 0xFFFFFFFF;
+
+    enum RecordKind : uint32_t
+    {
+        drivingQuery = 1,
+        drivingWalkingQuery = 2,
+        update = 3,
+        engine = 4,
+        independentResult = 5,
+        restrictedResult = 6,
+        ecoResult = 7,
+        invalidQuery = 8,
+        drivingWalkingParetoQuery = 9,
+        paretoResult = 10,
+    };
+
+    enum QueryFlags : uint32_t
+    {
+        restricted = 1, //* driving query with restrictions (even if every list is empty), answered as a restricted route
+        anyOrder = 2,   //* included vertices may be visited in any order
+        aproximate = 4, //* driving-walking query that wants approximations if no route fits
+    };
+
+    enum ResultFlags : uint32_t
+    {
+        found = 1,
+        aproximated = 2, //* the query asked for approximations
+        stopped = 12,    //* the QueryBudget::Stop of a query stopped before it finished, shifted by stoppedShift, it has no routes
+    };
+    const uint32_t stoppedShift = 2;
+
+    struct BinaryHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexCount; //* of the graph the vertex indices refer to
+        uint32_t recordCount;
+    };
+
+    struct BinaryRecord
+    {
+        uint32_t kind;
+        uint32_t size; //* bytes of the whole record, this header included
+    };
+
+    struct BinaryQuery
+    {
+        uint32_t flags;
+        uint32_t source;
+        uint32_t destination;
+        uint32_t nameLength;
+        uint32_t avoidNodeCount;
+        uint32_t avoidSegmentCount;
+        uint32_t includeCount;
+        uint32_t reserved;
+        double maxWalkTime; //* INF for driving queries
+        double departure;   //* minutes after midnight of a time dependent driving query, -1 for none
+        int64_t deadline;   //* milliseconds the query may take, 0 for no limit, -1 for the limit of the batch
+        int64_t maxSettled; //* vertices its searches may settle, 0 for no limit, -1 for the limit of the batch
+    };
+
+    struct BinaryUpdate
+    {
+        uint32_t origin;
+        uint32_t destination;
+        double driveTime;
+        double walkTime;
+    };
+
+    struct BinaryEngine
+    {
+        uint32_t engine;
+        uint32_t reserved;
+    };
+
+    struct BinaryResult
+    {
+        uint32_t flags;
+        uint32_t source;
+        uint32_t destination;
+        uint32_t nameLength;
+        uint32_t routeCount;
+        uint32_t listed;
+        double maxWalkTime;
+        double departure; //* -1 for none
+    };
+
+    struct BinaryRoute
+    {
+        uint32_t number;
+        uint32_t parking; //* noVertex if not an eco route
+        uint32_t drivePathLength;
+        uint32_t walkPathLength;
+        double driveTime;
+        double walkTime;
+    };
+
+    /**
+     * @brief A record of a mapped file, pointing into the file itself.
+     */
+    struct RecordView
+    {
+        uint32_t kind;
+        const char* body; //* what follows the BinaryRecord
+        uint32_t size;    //* bytes of the body
+    };
+
+    /**
+     * @brief A query record with its lists, pointing into the file itself.
+     */
+    struct QueryView
+    {
+        BinaryQuery query;
+        std::string name;
+        const uint32_t* avoidNodes;
+        const uint32_t* avoidSegments; //* origin and destination of every segment, one after the other
+        const uint32_t* include;
+    };
+
+    /**
+     * @brief Reads the records of a binary file in place, checking that each one fits in the file.
+     */
+    class Reader
+    {
+    public:
+        /**
+         * @param magic Either requestMagic or resultMagic, the file is not valid if it has the other one.
+         */
+        Reader(const std::string& filename, const char* magic);
+
+        //* The file exists and its header has the given magic and this version
+        bool isValid() const { return valid; }
+        const BinaryHeader& getHeader() const { return header; }
+
+        /**
+         * @brief Moves to the next record.
+         *
+         * @return false at the end of the file, or if the next record does not fit in it (see isComplete).
+         */
+        bool next(RecordView& record);
+
+        //* Whether every record was read and the file holds as many as its header says
+        bool isComplete() const { return complete; }
+
+    private:
+        MappedFile file;
+        BinaryHeader header;
+        bool valid = false;
+        bool complete = false;
+        size_t offset = sizeof(BinaryHeader);
+        uint32_t records = 0;
+    };
+
+    //* Whether the file starts with the given magic
+    bool hasMagic(const std::string& filename, const char* magic);
+
+    /**
+     * @brief Reads the lists of a query record.
+     *
+     * @return false if they don't fit in the record.
+     */
+    bool readQuery(const RecordView& record, QueryView& view);
+
+    void appendHeader(std::string& out, const char* magic, uint32_t vertexCount, uint32_t recordCount);
+
+    /**
+     * @brief Writes a query record (request) to out.
+     *
+     * @param name The text of the query name after the '#'.
+     * @param deadline, maxSettled The limits of the query, -1 for the ones of the batch (see CLInterface::limitQueries).
+     */
+    void appendQuery(std::string& out, RecordKind kind, uint32_t flags, const std::string& name, Vertex<int>* source, Vertex<int>* destination,
+        double maxWalkTime, double departure, int64_t deadline, int64_t maxSettled, const std::vector<Vertex<int>*>& nAvoid, const std::vector<Edge<int>*>& eAvoid, const std::vector<Vertex<int>*>& include);
+
+    void appendUpdate(std::string& out, Edge<int>* e, double driveTime, double walkTime);
+    void appendEngine(std::string& out, uint32_t engine);
+
+    /**
+     * @brief Writes a query result record to out.
+     *
+     * @param indices Index of every vertex id, since result paths hold ids.
+     */
+    void appendResult(std::string& out, const std::string& name, const QueryResult& result, const std::unordered_map<int, int>& indices);
+
+    /**
+     * @brief Writes a restrictedResult record with a single driving route given by vertex indices, for results that
+     * don't come from a loaded graph (see Parsefile::parseRegionInput).
+     *
+     * @param path The vertices of the route, empty with a time of 0 if it was not found.
+     */
+    void appendRoute(std::string& out, const std::string& name, uint32_t source, uint32_t destination, double driveTime, const std::vector<int>& path);
+
+    //* Writes an invalidQuery result record to out
+    void appendInvalid(std::string& out, const std::string& name);
+
+    /**
+     * @brief Converts a binary requests or results file, told apart by their magic, to the text format.
+     *
+     * Requests become an input file for the batch mode, with every query followed by an empty line (two after a
+     * driving-walking query without Aproximate, or its avoid lists would carry over to the next query). Results
+     * become the same lines the batch mode writes for their queries, each result followed by a single empty line. The
+     * batch mode's own empty lines between results depend on how the input file spaces its queries, which a results
+     * file does not keep, so only the result lines are reproduced.
+     *
+     * @param g The graph the vertex indices refer to.
+     * @return 0 on success, 1 if the input file is not a valid binary file for g.
+     *
+     * O(F) time complexity, where F is the size of the file.
+     */
+    int toText(const std::string& inputFileName, const std::string& outputFileName, Graph<int>* g);
+}
+
+#endif //BINARY_BATCH_H
@@ -1,8 +1,202 @@
 #include "CLInterface.h"
 #include "ShortestPathAlgorithms.cpp"
 #include "ParseFile.h"
+#include "WaypointOrder.h"
+#include "Metrics.h"
+#include "GraphPartition.h"
+#include <algorithm>
+#include <sstream>
 using namespace std;
 
+ResultCache CLInterface::resultCache;
+ShortestPathTreeCache<int> CLInterface::treeCache;
+CLInterface::Engine CLInterface::engine = CLInterface::Engine::plainDijkstra;
+CustomizableCH CLInterface::cch;
+MultiLevelOverlay CLInterface::overlay;
+HubLabels CLInterface::driveLabels;
+string CLInterface::hubLabelDirectory;
+RestrictionMask CLInterface::mask;
+BidirectionalSearch CLInterface::legSearch;
+ParetoSearch CLInterface::paretoSearch;
+vector<int> CLInterface::drivePath;
+vector<int> CLInterface::walkPath;
+vector<Edge<int>*> CLInterface::walkTree;
+TravelTimeProfiles<int> CLInterface::profiles;
+ParkingOccupancy CLInterface::occupancy;
+ComponentLabels<int> CLInterface::components;
+string CLInterface::occupancyFeed;
+unsigned CLInterface::occupancyInterval = OCCUPANCY_FEED_INTERVAL;
+QueryLimits CLInterface::queryLimits;
+QueryLimits CLInterface::activeLimits;
+CancellationToken CLInterface::cancellation;
+
+ResultCache& CLInterface::getResultCache() {
+    return resultCache;
+}
+
+ShortestPathTreeCache<int>& CLInterface::getTreeCache() {
+    return treeCache;
+}
+
+TravelTimeProfiles<int>& CLInterface::getProfiles() {
+    return profiles;
+}
+
+ParkingOccupancy& CLInterface::getOccupancy() {
+    return occupancy;
+}
+
+void CLInterface::followOccupancyFeed(const string& filename, unsigned seconds) {
+    occupancyFeed = filename;
+    occupancyInterval = seconds;
+}
+
+void CLInterface::useHubLabels(const string& directory) {
+    hubLabelDirectory = directory;
+}
+
+string CLInterface::hubLabelFile(const string& directory, Distance distance) {
+    string prefix = directory.empty() || directory.back() == '/' ? directory : directory + "/";
+    return prefix + (distance == Distance::drive ? "hublabels_drive.bin" : "hublabels_walk.bin");
+}
+
+void CLInterface::loadHubLabels(Graph<int>* g) {
+    driveLabels.clear();
+    if (hubLabelDirectory.empty()) return;
+    string filename = hubLabelFile(hubLabelDirectory, Distance::drive);
+    if (!driveLabels.load(filename) || !driveLabels.matches(g) || driveLabels.getMetric() != Distance::drive) {
+        cerr << "Hub labels in " << filename << " are missing or not for this graph, they are not used" << endl;
+        driveLabels.clear();
+    }
+}
+
+void CLInterface::attachGraph(Graph<int>* g) {
+    resultCache.clear();
+    treeCache.clear();
+    walkTree.clear();
+    cch = CustomizableCH();
+    overlay = MultiLevelOverlay();
+    if (engine != Engine::plainDijkstra) setEngine(engine, g);
+    occupancy.attach(g);
+    components.build(g);
+    loadHubLabels(g);
+}
+
+void CLInterface::setQueryLimits(const QueryLimits& limits) {
+    queryLimits = limits;
+    activeLimits = limits;
+}
+
+void CLInterface::limitQueries(int64_t deadlineMs, int64_t maxSettled) {
+    activeLimits = queryLimits.overriddenBy(deadlineMs, maxSettled);
+}
+
+CancellationToken& CLInterface::getCancellation() {
+    return cancellation;
+}
+
+int CLInterface::loadProfiles(const string& distances, Graph<int>* g) {
+    profiles.clear();
+    size_t slash = distances.find_last_of("/\\");
+    string filename = (slash == string::npos ? "" : distances.substr(0, slash + 1)) + "Profiles.csv";
+    if (!ifstream(filename).is_open()) return 0; // the profiles are optional
+    Parsefile parser;
+    return parser.parseProfiles(filename, g, profiles);
+}
+
+void CLInterface::setEngine(Engine engine, Graph<int>* g) {
+    if (engine == Engine::customizableCH && !cch.isBuilt()) {
+        cch.build(g);
+    }
+    if (engine == Engine::multiLevelOverlay && !overlay.isBuilt()) {
+        overlay.build(g);
+    }
+    if (engine != CLInterface::engine) {
+        resultCache.clear();
+    }
+    CLInterface::engine = engine;
+}
+
+double CLInterface::cchPath(Vertex<int>* sNode, Vertex<int>* dNode, vector<int>& path, vector<Edge<int>*>& edges) {
+    if (cch.needsCustomization(Distance::drive)) {
+        cch.customize(Distance::drive);
+    }
+    return cch.query(sNode, dNode, path, &edges);
+}
+
+double CLInterface::overlayPath(Vertex<int>* sNode, Vertex<int>* dNode, vector<int>& path, vector<Edge<int>*>& edges) {
+    if (overlay.needsCustomization()) {
+        overlay.customize();
+    }
+    return overlay.query(sNode, dNode, path, &edges);
+}
+
+bool CLInterface::orderStops(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& stops, bool restricted, Graph<int>* g) {
+    sort(stops.begin(), stops.end(), [](Vertex<int>* a, Vertex<int>* b) { return a->getIndex() < b->getIndex(); });
+    stops.erase(unique(stops.begin(), stops.end()), stops.end());
+
+    //* every leg is a shortest path, so the matrix of shortest distances between the points decides the order
+    vector<Vertex<int>*> points;
+    points.push_back(sNode);
+    points.insert(points.end(), stops.begin(), stops.end());
+    points.push_back(dNode);
+    vector<vector<double>> cost;
+    if (!restricted && driveLabels.isBuilt()) {
+        //* a row of lookups instead of a search per point
+        vector<int> indices;
+        for (Vertex<int>* p : points) indices.push_back(p->getIndex());
+        cost.resize(points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            driveLabels.distances(indices[i], indices, cost[i]);
+            cost[i][i] = 0;
+        }
+    }
+    else {
+        distanceMatrix(g, points, Distance::drive, &mask, cost);
+    }
+
+    vector<int> order;
+    if (orderWaypoints(cost, order) == INF) return false;
+    vector<Vertex<int>*> ordered;
+    for (int i : order) ordered.push_back(points[i]);
+    stops.swap(ordered);
+    return true;
+}
+
+void CLInterface::updateEdge(Edge<int>* e, double walkTime, double driveTime, Graph<int>* g) {
+    double oldWalkTime = e->getWalkTime(), oldDriveTime = e->getDriveTime();
+    g->updateEdge(e, walkTime, driveTime);
+    //* the new drive time holds at any time of the day
+    profiles.remove(e);
+    profiles.remove(e->getReverse());
+    resultCache.clear();
+    treeCache.repair(e, Distance::walk, oldWalkTime, walkTime);
+    treeCache.repair(e, Distance::drive, oldDriveTime, driveTime);
+    components.update(e, Distance::walk, oldWalkTime, walkTime);
+    components.update(e, Distance::drive, oldDriveTime, driveTime);
+    overlay.markChanged(e);
+    driveLabels.clear();
+}
+
+bool CLInterface::mayDrive(Vertex<int>* sNode, const vector<Vertex<int>*>& stops, Vertex<int>* dNode) {
+    if (!components.mayReach(sNode->getIndex(), dNode->getIndex(), Distance::drive)) return false;
+    for (Vertex<int>* stop : stops) {
+        if (!components.mayReach(sNode->getIndex(), stop->getIndex(), Distance::drive)) return false;
+        if (!components.mayReach(stop->getIndex(), dNode->getIndex(), Distance::drive)) return false;
+    }
+    return true;
+}
+
+bool CLInterface::mayPark(Vertex<int>* sNode, Vertex<int>* dNode, bool toDest) {
+    for (Vertex<int>* p : occupancy.parkingVertices()) {
+        if (p == sNode || p == dNode || !occupancy.isAvailable(p)) continue;
+        bool walkable = toDest ? components.mayReach(p->getIndex(), dNode->getIndex(), Distance::walk)
+            : components.mayReach(dNode->getIndex(), p->getIndex(), Distance::walk);
+        if (walkable && components.mayReach(sNode->getIndex(), p->getIndex(), Distance::drive)) return true;
+    }
+    return false;
+}
+
 
 int CLInterface::presentUI(const string& locations, const string& distances, ostream& outFile) {
     Graph<int> g;
@@ -10,11 +204,16 @@ int CLInterface::presentUI(const string& locations, const string& distances, ost
     if (locations.empty() || distances.empty()) {
         if(parser.parseLocation("../data_files/Locations.csv", &g)) return 1;
         if(parser.parseDistance("../data_files/Distances.csv", &g)) return 1;
+        if(loadProfiles("../data_files/Distances.csv", &g)) return 1;
     }
     else {
         if(parser.parseLocation(locations, &g)) return 1;
         if(parser.parseDistance(distances, &g)) return 1;
+        if(loadProfiles(distances, &g)) return 1;
     }
+    attachGraph(&g);
+    //* the menu answers one query at a time, the feed is read once instead of followed
+    if (!occupancyFeed.empty()) occupancy.load(occupancyFeed);
 
 
     while (true) {
@@ -85,7 +284,9 @@ void CLInterface::independantRoute(Graph<int>* g, ostream& outFile, const std::s
     } while (dNodePtr == nullptr);
 
     cout << endl;
-    outputIndependentResult(sNodePtr, dNodePtr, g, outFile);
+    OutputSink result(outFile);
+    outputIndependentResult(sNodePtr, dNodePtr, g, result);
+    result.flush();
 
     cout << "Press any key to continue..." << endl;
     cin.ignore(); // clear the newline character from the input buffer
@@ -190,7 +391,9 @@ void CLInterface::restrictedRoute(Graph<int>* g, ostream& outFile, const std::st
     } while (must == nullptr);
 
     cout << endl;
-    outputRestrictedResult(sNodePtr, dNodePtr, nAvoid, eAvoid, must, g, outFile);
+    OutputSink result(outFile);
+    outputRestrictedResult(sNodePtr, dNodePtr, nAvoid, eAvoid, must, g, result);
+    result.flush();
     cout << "Press any key to continue..." << endl;
     cin.ignore(); // clear the newline character from the input buffer
     cin.get(); // wait for user input
@@ -304,7 +507,9 @@ void CLInterface::ecoFriendlyRoute(Graph<int>* g, ostream& outFile, const std::s
     } while (aproxStr != "y" && aproxStr != "Y" && aproxStr != "n" && aproxStr != "N");
 
     cout << endl;
-    outputEcoResult(sNodePtr, dNodePtr, nAvoid, eAvoid, maxWalkTime, aprox, g, outFile);
+    OutputSink result(outFile);
+    outputEcoResult(sNodePtr, dNodePtr, nAvoid, eAvoid, maxWalkTime, aprox, g, result);
+    result.flush();
     cout << "Press any key to continue..." << endl;
     cin.ignore(); // clear the newline character from the input buffer
     cin.get(); // wait for user input
@@ -319,77 +524,293 @@ void CLInterface::defaultRun(const std::string& locations, const std::string& di
     if (locations.empty() || distances.empty()) {
         parser.parseLocation("../data_files/Locations.csv", &g);
         parser.parseDistance("../data_files/Distances.csv", &g);
-        parser.parseInput("../input.txt", "../output.txt", &g);
+        loadProfiles("../data_files/Distances.csv", &g);
     }
     else {
         parser.parseLocation(locations, &g);
         parser.parseDistance(distances, &g);
+        loadProfiles(distances, &g);
+    }
+    attachGraph(&g);
+    unique_ptr<OccupancyFeed> feed;
+    if (!occupancyFeed.empty()) feed.reset(new OccupancyFeed(occupancy, occupancyFeed, occupancyInterval));
+    if (locations.empty() || distances.empty()) {
+        parser.parseInput("../input.txt", "../output.txt", &g);
+    }
+    else {
         parser.parseInput(inputFile, outputFile, &g);
     }
 }
 
-void CLInterface::outputIndependentResult(Vertex<int>* sNode, Vertex<int>* dNode, Graph<int>* g, ostream& outFile) {
+int CLInterface::convertBatch(bool toBinary, const std::string& locations, const std::string& distances, const std::string& inputFile, const std::string& outputFile) {
+    Graph<int> g;
+    Parsefile parser;
+    if (parser.parseLocation(locations, &g)) return 1;
+    if (parser.parseDistance(distances, &g)) return 1;
+    if (toBinary) return parser.convertInput(inputFile, outputFile, &g);
+    return BinaryBatch::toText(inputFile, outputFile, &g);
+}
+
+int CLInterface::checkDeltaStepping(const std::string& locations, const std::string& distances) {
+    Graph<int> g;
+    Parsefile parser;
+    if (parser.parseLocation(locations, &g)) return 1;
+    if (parser.parseDistance(distances, &g)) return 1;
+    const vector<Vertex<int>*>& vertices = g.getVertexSet();
+    vector<double> dist(vertices.size());
+    vector<Edge<int>*> path(vertices.size());
+    int mismatches = 0;
+    for (Distance distance : { Distance::drive, Distance::walk }) {
+        for (Vertex<int>* origin : vertices) {
+            dijkstra(&g, origin, distance, nullptr);
+            for (size_t i = 0; i < vertices.size(); i++) {
+                dist[i] = vertices[i]->getDist();
+                path[i] = vertices[i]->getPath();
+            }
+            deltaStepping(&g, origin, distance);
+            size_t differ = 0;
+            for (size_t i = 0; i < vertices.size(); i++) {
+                if (vertices[i]->getDist() != dist[i]) {
+                    differ++;
+                    continue;
+                }
+                if (vertices[i]->getPath() == path[i] || dist[i] == INF) continue;
+                //* the paths only have to match when the tie is unique
+                int optimal = 0;
+                for (Edge<int>* e : vertices[i]->getIncoming()) {
+                    double weight = distance == Distance::drive ? e->getDriveTime() : e->getWalkTime();
+                    if (dist[e->getOrig()->getIndex()] + weight == dist[i]) optimal++;
+                }
+                if (optimal == 1) differ++;
+            }
+            if (differ == 0) continue;
+            mismatches++;
+            cout << (distance == Distance::drive ? "Driving" : "Walking") << " from " << origin->getInfo() << ": "
+                << differ << " vertices differ" << endl;
+        }
+    }
+    cout << mismatches << " of " << 2 * vertices.size() << " searches differ" << endl;
+    return mismatches != 0;
+}
 
-    outFile << "Source:" << sNode->getInfo() << endl;
-    outFile << "Destination:" << dNode->getInfo() << endl;
+int CLInterface::partitionGraph(const std::string& locations, const std::string& distances, const std::string& directory) {
+    Graph<int> g;
+    Parsefile parser;
+    if (parser.parseLocation(locations, &g)) return 1;
+    if (parser.parseDistance(distances, &g)) return 1;
+    GraphPartition partition;
+    partition.build(&g);
+    return partition.write(&g, directory);
+}
 
-    //* A first drivingDijsktra's is called for the first shortest path
-    resetGraph(g);
-    dijkstra(g, sNode, Distance::drive);
+int CLInterface::answerFromRegions(const std::string& directory, const std::string& inputFile, const std::string& outputFile) {
+    Parsefile parser;
+    return parser.parseRegionInput(directory, inputFile, outputFile);
+}
 
-    vector<int> v;
-    double dist = getPath(g, sNode, dNode, v, true);
-    outFile << "BestDrivingRoute:";
-    if (dist > 0) {
-        outputPath(v, outFile);
-        outFile << '(' << dist << ')' << endl;
+int CLInterface::buildHubLabels(const std::string& locations, const std::string& distances, const std::string& directory) {
+    Graph<int> g;
+    Parsefile parser;
+    if (parser.parseLocation(locations, &g)) return 1;
+    if (parser.parseDistance(distances, &g)) return 1;
+    CustomizableCH ch;
+    ch.build(&g);
+    for (Distance distance : { Distance::drive, Distance::walk }) {
+        HubLabels labels;
+        labels.build(&g, ch, distance);
+        if (labels.write(hubLabelFile(directory, distance))) return 1;
     }
-    else {
-        outFile << "none" << endl;
+    return 0;
+}
+
+void CLInterface::outputIndependentResult(Vertex<int>* sNode, Vertex<int>* dNode, Graph<int>* g, OutputSink& outFile) {
+    QueryResult result;
+    independentResult(sNode, dNode, g, result);
+    result.writeText(outFile);
+}
+
+void CLInterface::outputRestrictedResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, Vertex<int>* must, Graph<int>* g, OutputSink& outFile) {
+    vector<Vertex<int>*> waypoints;
+    if (must != nullptr) waypoints.push_back(must);
+    outputRestrictedResult(sNode, dNode, nAvoid, eAvoid, waypoints, false, g, outFile);
+}
+
+void CLInterface::outputRestrictedResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, const vector<Vertex<int>*>& waypoints, bool anyOrder, Graph<int>* g, OutputSink& outFile) {
+    QueryResult result;
+    restrictedResult(sNode, dNode, nAvoid, eAvoid, waypoints, anyOrder, g, result);
+    result.writeText(outFile);
+}
+
+void CLInterface::outputEcoResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, const double& maxWalkTime, const bool& aprox, Graph<int>* g, OutputSink& outFile) {
+    QueryResult result;
+    ecoResult(sNode, dNode, nAvoid, eAvoid, maxWalkTime, aprox, g, result);
+    result.writeText(outFile);
+}
+
+void CLInterface::independentResult(Vertex<int>* sNode, Vertex<int>* dNode, Graph<int>* g, QueryResult& result, double departure) {
+    QueryTimer timer(Metrics::independentQuery);
+    QueryKey key = QueryKey::independentQuery(sNode, dNode, departure);
+    if (!resultCache.lookup(key, result)) {
+        QueryBudget budget(activeLimits, &cancellation);
+        computeIndependentResult(sNode, dNode, g, result, departure);
+        if (!stopResult(budget, result)) resultCache.insert(key, result);
     }
+}
 
-    dijkstra(g, sNode, Distance::drive);
-    dist = getPath(g, sNode, dNode, v, true);
-    outFile << "AlternativeDrivingRoute:";
-    if (dist > 0) {
-        outputPath(v, outFile);
-        outFile << '(' << dist << ')' << endl;
+void CLInterface::restrictedResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, const vector<Vertex<int>*>& waypoints, bool anyOrder, Graph<int>* g, QueryResult& result, double departure) {
+    QueryTimer timer(Metrics::restrictedQuery);
+    QueryKey key = QueryKey::restrictedQuery(sNode, dNode, nAvoid, eAvoid, waypoints, anyOrder, departure);
+    if (!resultCache.lookup(key, result)) {
+        QueryBudget budget(activeLimits, &cancellation);
+        computeRestrictedResult(sNode, dNode, nAvoid, eAvoid, waypoints, anyOrder, g, result, departure);
+        if (!stopResult(budget, result)) resultCache.insert(key, result);
     }
-    else {
-        outFile << "none" << endl;
+}
+
+void CLInterface::ecoResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, const double& maxWalkTime, const bool& aprox, Graph<int>* g, QueryResult& result) {
+    QueryTimer timer(Metrics::ecoQuery);
+    uint64_t version = occupancy.getVersion();
+    QueryKey key = QueryKey::ecoQuery(sNode, dNode, nAvoid, eAvoid, maxWalkTime, aprox, version);
+    if (!resultCache.lookup(key, result)) {
+        QueryBudget budget(activeLimits, &cancellation);
+        computeEcoResult(sNode, dNode, nAvoid, eAvoid, maxWalkTime, aprox, g, result);
+        //* not cached if the occupancy changed while it was computed, it may mix both versions
+        if (!stopResult(budget, result) && occupancy.getVersion() == version) resultCache.insert(key, result);
     }
+}
 
-    outFile << endl;
+void CLInterface::paretoResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, Graph<int>* g, QueryResult& result) {
+    QueryTimer timer(Metrics::paretoQuery);
+    uint64_t version = occupancy.getVersion();
+    QueryKey key = QueryKey::paretoQuery(sNode, dNode, nAvoid, eAvoid, version);
+    if (!resultCache.lookup(key, result)) {
+        QueryBudget budget(activeLimits, &cancellation);
+        computeParetoResult(sNode, dNode, nAvoid, eAvoid, g, result);
+        if (!stopResult(budget, result) && occupancy.getVersion() == version) resultCache.insert(key, result);
+    }
 }
 
-void CLInterface::outputRestrictedResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, Vertex<int>* must, Graph<int>* g, ostream& outFile) {
+bool CLInterface::stopResult(const QueryBudget& budget, QueryResult& result) {
+    if (!budget.isExhausted()) return false;
+    //* what describes the query is kept, the routes can't be trusted
+    result.routes.clear();
+    result.found = false;
+    result.listed = 0;
+    result.stopped = budget.getStop();
+    Metrics::add(Metrics::timeouts);
+    return true;
+}
 
-    outFile << "Source:" << sNode->getInfo() << endl;
-    outFile << "Destination:" << dNode->getInfo() << endl;
+//* A query stopped by its budget is a timeout, not a query without a route
+static void recordFailure(Metrics::QueryKind kind) {
+    QueryBudget* budget = QueryBudget::active();
+    if (budget == nullptr || !budget->isExhausted()) Metrics::recordFailure(kind);
+}
 
-    //* A first drivingDijsktra's is called for the first shortest path
-    resetGraph(g);
-    restrictedDrivingDijkstra(g, sNode, nAvoid, eAvoid, must);
+void CLInterface::computeIndependentResult(Vertex<int>* sNode, Vertex<int>* dNode, Graph<int>* g, QueryResult& result, double departure) {
+    result = QueryResult();
+    result.kind = QueryResult::independent;
+    result.source = sNode;
+    result.destination = dNode;
+    result.departure = departure;
+    if (!mayDrive(sNode, {}, dNode)) {
+        //* in different components, neither route exists
+        result.routes.resize(2);
+        recordFailure(Metrics::independentQuery);
+        return;
+    }
 
-    vector<int> v;
-    double dist = getRestrictedPath(g, sNode, dNode, must, v);
-    outFile << "RestrictedDrivingRoute:";
-    if (dist > 0) {
-        outputPath(v, outFile);
-        outFile << '(' << dist << ')' << endl;
+    //* A first drivingDijsktra's is called for the first shortest path, which is then marked on the mask
+    mask.resize(g->getCodeVertex(), g->getEdgeCount());
+    vector<int>& v = drivePath;
+    double dist;
+    if (departure >= 0) {
+        //* trees depend on the departure time, so neither the engine nor the tree cache are used
+        timeDependentDijkstra(g, sNode, departure, profiles);
+        dist = getPath(g, sNode, dNode, v, true, &mask);
+    }
+    else if (engine == Engine::customizableCH) {
+        vector<Edge<int>*> edges;
+        dist = cchPath(sNode, dNode, v, edges);
+        selectPath(edges, mask);
+    }
+    else if (engine == Engine::multiLevelOverlay) {
+        vector<Edge<int>*> edges;
+        dist = overlayPath(sNode, dNode, v, edges);
+        selectPath(edges, mask);
     }
     else {
-        outFile << "none" << endl;
+        cachedDijkstra(g, sNode, Distance::drive, {}, {}, &treeCache);
+        dist = getPath(g, sNode, dNode, v, true, &mask);
     }
+    result.routes.emplace_back();
+    if (dist > 0) setDrivingRoute(result.routes.back(), v, dist);
+    else recordFailure(Metrics::independentQuery);
 
-    outFile << endl;
+    if (departure >= 0) timeDependentDijkstra(g, sNode, departure, profiles, &mask);
+    else dijkstra(g, sNode, Distance::drive, &mask);
+    dist = getPath(g, sNode, dNode, v, true);
+    result.routes.emplace_back();
+    if (dist > 0) setDrivingRoute(result.routes.back(), v, dist);
+}
+
+void CLInterface::computeRestrictedResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, const vector<Vertex<int>*>& waypoints, bool anyOrder, Graph<int>* g, QueryResult& result, double departure) {
+    result = QueryResult();
+    result.kind = QueryResult::restricted;
+    result.source = sNode;
+    result.destination = dNode;
+    result.departure = departure;
+    if (!mayDrive(sNode, waypoints, dNode)) {
+        result.routes.emplace_back();
+        recordFailure(Metrics::restrictedQuery);
+        return;
+    }
+
+    vector<int>& v = drivePath;
+    double dist;
+    if (departure >= 0) {
+        mask.resize(g->getCodeVertex(), g->getEdgeCount());
+        prepareRestrictedGraph(mask, nAvoid, eAvoid);
+        vector<Vertex<int>*> stops = waypoints;
+        //* the order is chosen with the fixed drive times, the legs are then driven at the time they start
+        bool ordered = !(anyOrder && stops.size() > 1) || orderStops(sNode, dNode, stops, !nAvoid.empty() || !eAvoid.empty(), g);
+        dist = ordered ? timeDependentRoute(sNode, stops, dNode, departure, g, v) : -1;
+    }
+    else if (engine == Engine::customizableCH && nAvoid.empty() && eAvoid.empty() && waypoints.empty()) {
+        vector<Edge<int>*> edges;
+        dist = cchPath(sNode, dNode, v, edges);
+    }
+    else if (engine == Engine::multiLevelOverlay && nAvoid.empty() && eAvoid.empty() && waypoints.empty()) {
+        vector<Edge<int>*> edges;
+        dist = overlayPath(sNode, dNode, v, edges);
+    }
+    else if (!waypoints.empty()) {
+        //* One point to point search per leg, origin to the first waypoint, between waypoints and to the destination
+        mask.resize(g->getCodeVertex(), g->getEdgeCount());
+        prepareRestrictedGraph(mask, nAvoid, eAvoid);
+        vector<Vertex<int>*> stops = waypoints;
+        if (anyOrder && stops.size() > 1) {
+            dist = orderStops(sNode, dNode, stops, !nAvoid.empty() || !eAvoid.empty(), g) ? legSearch.queryThrough(g, sNode, stops, dNode, Distance::drive, &mask, v) : -1;
+        }
+        else {
+            dist = legSearch.queryThrough(g, sNode, stops, dNode, Distance::drive, &mask, v);
+        }
+    }
+    else {
+        //* A first drivingDijsktra's is called for the first shortest path
+        mask.resize(g->getCodeVertex(), g->getEdgeCount());
+        restrictedDrivingDijkstra<int>(g, sNode, nAvoid, eAvoid, nullptr, mask, &treeCache);
+        dist = getRestrictedPath<int>(g, sNode, dNode, nullptr, v);
+    }
+    result.routes.emplace_back();
+    if (dist > 0) setDrivingRoute(result.routes.back(), v, dist);
+    else recordFailure(Metrics::restrictedQuery);
 }
 
 struct parkingNode
 {
     Vertex<int>* node;
     double dist;
-    vector<int> path;
 };
 bool parkingSort(const parkingNode& a, const parkingNode& b) {
     if (a.node->getDist() + a.dist < b.node->getDist() + b.dist) return true;
@@ -397,102 +818,130 @@ bool parkingSort(const parkingNode& a, const parkingNode& b) {
     return false;
 }
 
-void CLInterface::outputEcoResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, const double& maxWalkTime, const bool& aprox, Graph<int>* g, ostream& outFile) {
-
-    outFile << "Source:" << sNode->getInfo() << endl;
-    outFile << "Destination:" << dNode->getInfo() << endl;
+void CLInterface::computeEcoResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, const double& maxWalkTime, const bool& aprox, Graph<int>* g, QueryResult& result) {
+    result = QueryResult();
+    result.kind = QueryResult::eco;
+    result.source = sNode;
+    result.destination = dNode;
+    result.aproximate = aprox;
+    result.maxWalkTime = maxWalkTime;
+    //* without approximations nothing but a found route is written, and none can be without a car park in reach
+    if (!aprox && !mayPark(sNode, dNode, false)) {
+        recordFailure(Metrics::ecoQuery);
+        return;
+    }
 
-    //* First the graph is reset and then set up for the eco-friendly route
-    resetGraph(g);
-    prepareRestrictedGraph(nAvoid, eAvoid);
+    //* The restrictions are set up once, both searches use them
+    mask.resize(g->getCodeVertex(), g->getEdgeCount());
+    prepareRestrictedGraph(mask, nAvoid, eAvoid);
 
     //* First dijkstra's from the destination node to each of the parking nodes
-    dijkstra(g, dNode, Distance::walk);
+    cachedDijkstra(g, dNode, Distance::walk, nAvoid, eAvoid, &treeCache, &mask);
+    //* Only the walking paths of the parking nodes that end up printed are built, from this copy of the tree
+    walkTree.resize(g->getCodeVertex());
+    for (Vertex<int>* v : searchAdjacency(g).vertices()) {
+        walkTree[v->getIndex()] = v->getPath();
+    }
+    //* Only the car parks with free spaces are looked at, and without approximations only the ones in walking range
     vector<parkingNode> parkingNodes;
-    for (auto v : g->getVertexSet()) {
-        if (v->getParking() == 1) {
-            parkingNode pNode;
-            pNode.node = v;
-            pNode.dist = v->getDist();
-            double dist = getPath(g, dNode, v, pNode.path, false);
-            if (dist > 0) {
-                parkingNodes.push_back(pNode);
-            }
-        }
+    for (Vertex<int>* v : occupancy.parkingVertices()) {
+        if (!occupancy.isAvailable(v)) continue;
+        //* reachable, and not the destination itself
+        if (v->getDist() <= 0 || v->getDist() == INF) continue;
+        if (!aprox && (v->getDist() > maxWalkTime || !components.mayReach(sNode->getIndex(), v->getIndex(), Distance::drive))) continue;
+        parkingNode pNode;
+        pNode.node = v;
+        pNode.dist = v->getDist();
+        parkingNodes.push_back(pNode);
     }
 
 
-    resetGraph(g);
-    prepareRestrictedGraph(nAvoid, eAvoid);
     //* Then dijkstra's from the source node to each of the parking nodes
-    dijkstra(g, sNode, Distance::drive);
+    cachedDijkstra(g, sNode, Distance::drive, nAvoid, eAvoid, &treeCache, &mask);
     //* After this one happens: dist holds the walkTime, pNode.node.getDist() holds the drive time
-    //* The Nodes should be sorted using this info
-    sort(parkingNodes.begin(), parkingNodes.end(), parkingSort);
+    //* The Nodes should be sorted using this info, keeping equally good ones in the order of the graph whatever was
+    //* filtered out above, so ties don't depend on the car parks that are full or out of reach
+    stable_sort(parkingNodes.begin(), parkingNodes.end(), parkingSort);
     for (auto& pNode : parkingNodes) {
         if (pNode.dist > maxWalkTime) continue;
-        vector<int> drive;
         if (pNode.dist == INF) continue; // no path to parking node
-        double dist = getPath(g, sNode, pNode.node, drive, true);
-        if (dist <= 0) continue;
-        outFile << "DrivingRoute:";
-        outputPath(drive, outFile);
-        outFile << '(' << pNode.node->getDist() << ')' << endl;
-
-        outFile << "ParkingNode:" << pNode.node->getInfo() << endl;
-        outFile << "WalkingRoute:";
-        outputPath(pNode.path, outFile);
-        outFile << '(' << pNode.dist << ')' << endl;
-        outFile << "TotalTime:" << pNode.dist + pNode.node->getDist() << endl;
-        drive.clear();
+        //* not reachable by car, or the source itself
+        if (pNode.node->getDist() <= 0 || pNode.node->getDist() == INF) continue;
+        getPath(g, sNode, pNode.node, drivePath, true);
+        treePath(walkTree, pNode.node, walkPath);
+        result.found = true;
+        result.routes.emplace_back();
+        setEcoRoute(result.routes.back(), pNode.node, pNode.dist);
         return;
     }
-    if (!aprox) {
-        //* if method gets to this point it means no paths were printed so we can check if the user wants the aproximate path
-        outFile << "DrivingRoute:" << endl;
-        outFile << "ParkingNode:" << endl;
-        outFile << "TotalTime:" << endl;
-        outFile << "Message: no possible route with max. walking time of " << maxWalkTime << " minutes." << endl;
-        return;
+    recordFailure(Metrics::ecoQuery);
+    //* if method gets to this point it means no paths were found so we can check if the user wants the aproximate path
+    if (!aprox) return;
+    int i = 0;
+    for (auto& pNode : parkingNodes) {
+        i++;
+        if (pNode.dist == INF) continue; // no path to parking node
+        if (pNode.node->getDist() == INF) continue;
+        getPath(g, sNode, pNode.node, drivePath, true);
+        treePath(walkTree, pNode.node, walkPath);
+        result.routes.emplace_back();
+        setEcoRoute(result.routes.back(), pNode.node, pNode.dist);
+        result.routes.back().number = i;
+        if (i == 2) break;
     }
-    else {
-        int i = 0;
-        for (auto& pNode : parkingNodes) {
-            i++;
-            vector<int> drive;
-            if (pNode.dist == INF) continue; // no path to parking node
-            double dist = getPath(g, sNode, pNode.node, drive, true);
-            if (dist == -1) continue;
-
-            outFile << "DrivingRoute" << i << ":";
-            outputPath(drive, outFile);
-            outFile << '(' << pNode.node->getDist() << ')' << endl;
-            outFile << "ParkingNode" << i << ":" << pNode.node->getInfo() << endl;
-            outFile << "WalkingRoute" << i << ":";
-            outputPath(pNode.path, outFile);
-            outFile << '(' << pNode.dist << ')' << endl;
-            outFile << "TotalTime" << i << ":" << pNode.dist + pNode.node->getDist() << endl;
-            drive.clear();
-            if (i == 2) break;
-        }
-        while (i < 2) {
-            i++;
-            outFile << "DrivingRoute" << i << ":" << endl;
-            outFile << "ParkingNode" << i << ":" << endl;
-            outFile << "WalkingRoute" << i << ":" << endl;
-            outFile << "TotalTime" << i << ":" << endl;
-        }
-
-        outFile << endl;
+    result.listed = i;
+}
 
-        return;
+double CLInterface::timeDependentRoute(Vertex<int>* sNode, const vector<Vertex<int>*>& stops, Vertex<int>* dNode, double departure, Graph<int>* g, vector<int>& path) {
+    path.clear();
+    double total = 0;
+    Vertex<int>* from = sNode;
+    for (size_t i = 0; i <= stops.size(); i++) {
+        Vertex<int>* to = i < stops.size() ? stops[i] : dNode;
+        //* every leg leaves when the one before it arrives
+        timeDependentDijkstra(g, from, departure + total, profiles, &mask);
+        if (!path.empty()) path.pop_back(); // the start of this leg is the end of the one before
+        double dist = appendPath(from, to, path, true, nullptr);
+        if (dist == -1) return -1;
+        total += dist;
+        from = to;
     }
+    return total;
 }
 
-void CLInterface::outputPath(vector<int>& v, ostream& out) {
-    if (v.empty()) return;
-    for (int i = 0; i < v.size() - 1; i++) {
-        out << v[i] << ',';
+void CLInterface::computeParetoResult(Vertex<int>* sNode, Vertex<int>* dNode, vector<Vertex<int>*>& nAvoid, vector<Edge<int>*>& eAvoid, Graph<int>* g, QueryResult& result) {
+    result = QueryResult();
+    result.kind = QueryResult::pareto;
+    result.source = sNode;
+    result.destination = dNode;
+
+    mask.resize(g->getCodeVertex(), g->getEdgeCount());
+    prepareRestrictedGraph(mask, nAvoid, eAvoid);
+    vector<ParetoSearch::Option> options;
+    if (mayPark(sNode, dNode, true)) paretoSearch.query(g, sNode, dNode, &mask, occupancy, options);
+    for (ParetoSearch::Option& option : options) {
+        result.routes.emplace_back();
+        QueryResult::Route& route = result.routes.back();
+        route.driveTime = option.driveTime;
+        route.drivePath.swap(option.drivePath);
+        route.parking = option.parking;
+        route.walkTime = option.walkTime;
+        route.walkPath.swap(option.walkPath);
+        route.number = result.routes.size();
     }
-    out << v[v.size() - 1];
+    result.found = !result.routes.empty();
+    if (!result.found) recordFailure(Metrics::paretoQuery);
+}
+
+void CLInterface::setDrivingRoute(QueryResult::Route& route, const vector<int>& path, double dist) {
+    route.driveTime = dist;
+    route.drivePath = path;
+}
+
+void CLInterface::setEcoRoute(QueryResult::Route& route, Vertex<int>* parking, double walkTime) {
+    route.driveTime = parking->getDist();
+    route.drivePath = drivePath;
+    route.parking = parking;
+    route.walkTime = walkTime;
+    route.walkPath = walkPath;
 }
@@ -6,10 +6,28 @@
 #include <Graph.h>
 #include "ParseFile.h"
 #include "ShortestPathAlgorithms.h"
+#include "ResultCache.h"
+#include "ContractionHierarchy.h"
+#include "MultiLevelOverlay.h"
+#include "HubLabels.h"
+#include "BidirectionalSearch.h"
+#include "ParetoSearch.h"
+#include "OutputSink.h"
+#include "QueryResult.h"
+#include "QueryBudget.h"
 
 class CLInterface
 {
 public:
+    /**
+     * @brief Search engines available for queries without restrictions.
+     */
+    enum Engine
+    {
+        plainDijkstra,
+        customizableCH, //* Customizable Contraction Hierarchy, customized again whenever drive times change
+        multiLevelOverlay, //* Multi-level overlay of cells, only the cells holding changed edges are customized again
+    };
 
     /**
      * @brief Presents a user interface for selecting different planning modes.
@@ -44,6 +62,60 @@ public:
      */
     void defaultRun(const std::string& locations, const std::string& distances, const std::string& inputFile, const std::string& outputFile);
 
+    /**
+     * @brief Converts a batch file between the text and the binary formats (see BinaryBatch.h), without answering it.
+     *
+     * @param toBinary true to convert a text input file to the binary requests format, false to convert a binary
+     * requests or results file to text.
+     * @param locations Path to the locations file of the graph the binary file refers to.
+     * @param distances Path to the distances file of that graph.
+     *
+     * @returns 0 upon success, non-zero otherwise.
+     */
+    int convertBatch(bool toBinary, const std::string& locations, const std::string& distances, const std::string& inputFile, const std::string& outputFile);
+
+    /**
+     * @brief Partitions the graph into regions and writes it as region files and an overlay (see GraphPartition.h),
+     * which answerFromRegions answers batches from.
+     *
+     * @param directory Existing directory the files are written to.
+     *
+     * @returns 0 upon success, non-zero otherwise.
+     */
+    int partitionGraph(const std::string& locations, const std::string& distances, const std::string& directory);
+
+    /**
+     * @brief Answers a binary requests file from the graph partitionGraph wrote to directory, loading only the regions
+     * the queries go through, see Parsefile::parseRegionInput.
+     *
+     * @returns 0 upon success, non-zero otherwise.
+     */
+    int answerFromRegions(const std::string& directory, const std::string& inputFile, const std::string& outputFile);
+
+    /**
+     * @brief Builds the driving and walking hub labels of the graph (see HubLabels.h) in the vertex order of its
+     * Contraction Hierarchy, and writes them to hubLabelFile(directory, metric).
+     *
+     * @param directory Existing directory the files are written to, such as the one of a partitioned graph.
+     *
+     * @returns 0 upon success, non-zero otherwise.
+     */
+    int buildHubLabels(const std::string& locations, const std::string& distances, const std::string& directory);
+
+    /**
+     * @brief Runs deltaStepping and dijkstra from every vertex of the graph, for both metrics, and prints the sources
+     * whose distances differ, or whose paths differ at a vertex reached optimally by a single edge (where several
+     * are, each search breaks the tie its own way).
+     *
+     * @returns 0 if every tree is the same, non-zero otherwise.
+     *
+     * O(V (E + V) log |V|) time complexity.
+     */
+    int checkDeltaStepping(const std::string& locations, const std::string& distances);
+
+    //* The file in directory holding the hub labels of a metric
+    static std::string hubLabelFile(const std::string& directory, Distance distance);
+
 
     /**
      * @brief Outputs the independent route planning results based on the given parameters..
@@ -54,13 +126,13 @@ public:
      * @param sNode A pointer to the source node involved in the query.
      * @param dNode A pointer to the destination node involved in the query.
      * @param g A pointer to the graph object containing the nodes and edges.
-     * @param outFile A reference to the output file stream where the result will be written.
+     * @param outFile The output sink where the result will be written.
      *
      * Dijkstra's shortest path algorithm dominates the time complexity of this method.
      * The overall time complexity is O((V + E) log V), where V is the number of vertices and E
      * is the number of edges in the graph.
      */
-    void outputIndependentResult(Vertex<int>* sNode, Vertex<int>* dNode, Graph<int>* g, std::ostream& outFile);
+    void outputIndependentResult(Vertex<int>* sNode, Vertex<int>* dNode, Graph<int>* g, OutputSink& outFile);
 
     /**
      * @brief Outputs the result of a restricted path query operation to a file or standard cout.
@@ -68,7 +140,8 @@ public:
      * This method calculates and outputs the best eco-friendly route from a source node
      * to a destination node and some restrictions like nodes and edges to avoid,
      * and a node that must be included.
-     * It uses Dijkstra's algorithm to compute the shortest path.
+     * It uses Dijkstra's algorithm to compute the shortest path. With a must node the route is made of two
+     * bidirectional point to point searches, origin to must and must to destination, which also holds on directed graphs.
      *
      * @param sNode A pointer to the source node involved in the query.
      * @param dNode A pointer to the destination node involved in the query.
@@ -76,13 +149,28 @@ public:
      * @param eAvoid A vector of pointers to edges that should be avoided in the path.
      * @param must A pointer to a node that must be included in the path.
      * @param g A pointer to the graph object containing the nodes and edges.
-     * @param outFile A reference to the output file stream where the result will be written.
+     * @param outFile The output sink where the result will be written.
      *
      * Dijkstra's shortest path algorithm dominates the time complexity of this method.
      * The overall time complexity is O((V + E) log V), where V is the number of vertices and E
      * is the number of edges in the graph.
      */
-    void outputRestrictedResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, Vertex<int>* must, Graph<int>* g, std::ostream& outFile);
+    void outputRestrictedResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, Vertex<int>* must, Graph<int>* g, OutputSink& outFile);
+
+    /**
+     * @brief Outputs the result of a restricted path query that goes through several waypoints.
+     *
+     * In order, the route chains one point to point search per leg. In any order, the shortest distances between
+     * the source, the waypoints and the destination are computed first, and the visiting order is chosen from them
+     * (see orderWaypoints) before the legs are searched.
+     *
+     * @param waypoints The nodes that must be included in the path, with a single one it is the same as the must version.
+     * @param anyOrder Whether the waypoints may be visited in any order, or must be visited in the given one.
+     *
+     * O(W (V + E) log V) time complexity for W waypoints, plus O(2^W W^2) to order up to WAYPOINT_EXACT_LIMIT waypoints
+     * in any order, or O(W^3) per improvement pass of the heuristic beyond that.
+     */
+    void outputRestrictedResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, const std::vector<Vertex<int>*>& waypoints, bool anyOrder, Graph<int>* g, OutputSink& outFile);
 
     /**
      * @brief Outputs the eco-friendly route planning results based on the given parameters.
@@ -98,24 +186,261 @@ public:
      * @param maxWalkTime Maximum allowed walking time in minutes.
      * @param aprox Boolean flag indicating whether to allow approximate routes if none exist in the given maxWalkTime.
      * @param g Pointer to the graph object representing the network.
-     * @param outFile Output stream to write the results.
+     * @param outFile Output sink to write the results.
      *
      * Dijkstra's shortest path algorithm dominates the time complexity of this method.
      * The overall time complexity is O(V^2), where V is the number of vertices in the graph.
      */
-    void outputEcoResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, const double& maxWalkTime, const bool& aprox, Graph<int>* g, std::ostream& outFile);
+    void outputEcoResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, const double& maxWalkTime, const bool& aprox, Graph<int>* g, OutputSink& outFile);
+
+    /**
+     * @brief Answers an independent query, same as outputIndependentResult but filling result instead of writing it.
+     * Used by the batch runner, which writes results either as text or in the binary format.
+     *
+     * @param departure Minutes after midnight the route starts at, -1 for none. With one, both routes are found with
+     * timeDependentDijkstra on the travel time profiles (see getProfiles) instead of the fixed drive times and engine.
+     */
+    void independentResult(Vertex<int>* sNode, Vertex<int>* dNode, Graph<int>* g, QueryResult& result, double departure = -1);
+
+    /**
+     * @brief Answers a restricted query, same as outputRestrictedResult but filling result instead of writing it.
+     *
+     * @param departure Minutes after midnight the route starts at, -1 for none. With one, each leg is a
+     * timeDependentDijkstra leaving when the previous leg arrives. Waypoints in any order are still ordered by the
+     * fixed drive times.
+     */
+    void restrictedResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, const std::vector<Vertex<int>*>& waypoints, bool anyOrder, Graph<int>* g, QueryResult& result, double departure = -1);
+
+    /**
+     * @brief Answers an eco-friendly query, same as outputEcoResult but filling result instead of writing it.
+     */
+    void ecoResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, const double& maxWalkTime, const bool& aprox, Graph<int>* g, QueryResult& result);
+
+    /**
+     * @brief Answers a Pareto query: every route that drives from sNode to a parking node and walks to dNode and
+     * is not beaten in both drive and walk time by another one (see ParetoSearch), following the restrictions.
+     *
+     * O(L log L + L d P) time complexity, where L is the amount of labels of the search, d the largest degree and
+     * P PARETO_MAX_LABELS.
+     */
+    void paretoResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, Graph<int>* g, QueryResult& result);
+
+    /**
+     * @brief Gives access to the cache shared by every output method, mostly to read its hit/miss counters.
+     *
+     * Repeated queries (same canonical source, destination, mode and restrictions) are answered straight from
+     * this cache without running any search. It must be cleared whenever the graph changes.
+     */
+    static ResultCache& getResultCache();
+
+    /**
+     * @brief Gives access to the shortest path tree cache shared by every output method.
+     *
+     * Queries sharing an origin and restrictions reuse the tree
+     * of the first one instead of searching again. It must be cleared whenever the graph changes.
+     */
+    static ShortestPathTreeCache<int>& getTreeCache();
+
+    /**
+     * @brief Gives access to the travel time profiles of the graph, loaded from Profiles.csv next to the distances
+     * file when there is one (see Parsefile::parseProfiles). Only queries with a departure time use them.
+     */
+    static TravelTimeProfiles<int>& getProfiles();
+
+    /**
+     * @brief Gives access to the occupancy of the car parks of the graph. Eco and Pareto queries only leave the car
+     * where there are free spaces, and their cached results are only reused while the occupancy stays the same.
+     */
+    static ParkingOccupancy& getOccupancy();
+
+    /**
+     * @brief Follows an occupancy file (see ParkingOccupancy::load) while the batch runs, rereading it every few
+     * seconds from a background thread. The menu reads it once, when the graph is loaded.
+     *
+     * @param filename The occupancy file, empty to not follow any.
+     * @param seconds The time between two reads.
+     */
+    static void followOccupancyFeed(const std::string& filename, unsigned seconds = OCCUPANCY_FEED_INTERVAL);
+
+    /**
+     * @brief Loads the driving hub labels written by buildHubLabels in directory whenever a graph is loaded, if they
+     * were built for it. Their distances order the waypoints of queries without avoided nodes or segments. They are
+     * dropped by the first update, since they hold the old drive times.
+     *
+     * @param directory The directory of the labels, empty to not use any.
+     */
+    static void useHubLabels(const std::string& directory);
+
+    /**
+     * @brief Sets the deadline and settled vertex budget of every query answered from now on. A query that runs out
+     * of either is stopped and answered with a Timeout result, which is not cached.
+     */
+    static void setQueryLimits(const QueryLimits& limits);
+
+    /**
+     * @brief Limits the queries answered from now on with the limits of setQueryLimits, each one replaced by the
+     * given value unless it is negative. The batch runner calls it before every query, with its Deadline and
+     * MaxSettled lines (-1 for the ones it does not have).
+     *
+     * @param deadlineMs Milliseconds the query may take, 0 for no limit.
+     * @param maxSettled Vertices its searches may settle, 0 for no limit.
+     */
+    static void limitQueries(int64_t deadlineMs, int64_t maxSettled);
+
+    /**
+     * @brief Gives access to the token that cancels the queries being answered, from any thread. Cancelled queries
+     * are answered with a Timeout result, and so is every query after them until the token is reset.
+     */
+    static CancellationToken& getCancellation();
+
+    /**
+     * @brief Changes the walking and driving times of an edge, in both directions, without reloading the graph.
+     *
+     * The result cache is cleared and the tree cache repaired, keeping only the trees the change cannot affect.
+     * The edge loses its travel time profiles, the new drive time holds at any time of the day.
+     * Queries already answered are not affected, the caller must only call this between queries (the batch runner
+     * answers every query read before an update first), so each query sees one consistent version of the graph.
+     *
+     * @param e The edge to change, either direction.
+     * @param walkTime The new walking time.
+     * @param driveTime The new driving time, INF if driving is not possible.
+     * @param g The graph the edge belongs to.
+     *
+     * O(C) time complexity, where C is the amount of cached trees.
+     */
+    void updateEdge(Edge<int>* e, double walkTime, double driveTime, Graph<int>* g);
+
+    /**
+     * @brief Chooses the engine used for the driving routes of queries without restrictions (no avoided
+     * nodes or segments, no must vertex). Routes with restrictions and eco routes always use dijkstra,
+     * and routes with a must vertex the bidirectional searches.
+     *
+     * The Contraction Hierarchy and the multi-level overlay are built from the topology of g the first time they are
+     * chosen, and customized with the current drive times before any query that finds them changed. The result cache is cleared, since ties between
+     * equally short routes may be broken differently by each engine.
+     *
+     * @param engine The engine to use.
+     * @param g The graph queries will run on.
+     */
+    void setEngine(Engine engine, Graph<int>* g);
 
 
 private:
-    /* Methods Meant for use in the interactive Menu */
+    static ResultCache resultCache;
+    static ShortestPathTreeCache<int> treeCache;
+    static Engine engine;
+    static CustomizableCH cch;
+    static MultiLevelOverlay overlay;
+    //* of the graph loaded by presentUI or defaultRun, only with useHubLabels and until the first update
+    static HubLabels driveLabels;
+    static std::string hubLabelDirectory;
+    //* restrictions of the query being answered, the graph itself is never marked
+    static RestrictionMask mask;
+    //* point to point searches for the legs of routes with waypoints
+    static BidirectionalSearch legSearch;
+    //* multi-criteria searches of Pareto queries
+    static ParetoSearch paretoSearch;
+    //* paths of the query being answered, kept between queries so their memory is reused
+    static std::vector<int> drivePath, walkPath;
+    //* walking search tree of an eco query, saved before the driving search replaces it
+    static std::vector<Edge<int>*> walkTree;
+    static TravelTimeProfiles<int> profiles;
+    static ParkingOccupancy occupancy;
+    //* of the graph loaded by presentUI or defaultRun, queries between vertices that can't reach each other skip the searches
+    static ComponentLabels<int> components;
+    static std::string occupancyFeed;
+    static unsigned occupancyInterval;
+    static QueryLimits queryLimits;
+    //* queryLimits with the limits of the query being answered, see limitQueries
+    static QueryLimits activeLimits;
+    static CancellationToken cancellation;
+
+    /**
+     * @brief Loads the travel time profiles from Profiles.csv in the same directory as the distances file.
+     *
+     * @return 0 on success or if there is no such file, 1 if it is not valid.
+     */
+    int loadProfiles(const std::string& distances, Graph<int>* g);
 
     /**
-     *  Method to aid in writing the path to the output stream.
+     * @brief Shortest driving path between 2 vertices using the Contraction Hierarchy, customizing it first if needed.
      *
-     *  @param v The vector of node IDs representing the path.
-     *  @param out The output stream to write the path to.
+     * @param path Filled with the ids of the vertices on the path.
+     * @param edges Filled with the edges of the path.
+     * @return The total distance of the path, -1 if there is no path.
      */
-    void outputPath(std::vector<int>& v, std::ostream& out);
+    double cchPath(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<int>& path, std::vector<Edge<int>*>& edges);
+
+    /**
+     * @brief Same as cchPath, using the multi-level overlay, customizing the cells whose drive times changed first.
+     */
+    double overlayPath(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<int>& path, std::vector<Edge<int>*>& edges);
+
+    /**
+     * @brief Puts waypoints that may be visited in any order in the order of the shortest route through all of them,
+     * following the restrictions already in the mask. Repeated waypoints are dropped.
+     *
+     * @param restricted false if the mask has no restrictions, the distances then come from the hub labels if loaded.
+     * @return false if some waypoint can't be visited.
+     */
+    bool orderStops(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& stops, bool restricted, Graph<int>* g);
+
+    //* Loads the hub labels of useHubLabels for g, dropping them if they are missing or for another graph
+    void loadHubLabels(Graph<int>* g);
+
+    /**
+     * @brief Makes g the graph queries run on. Everything kept from the graph loaded before (cached results and search
+     * trees, the engines, component labels and hub labels) holds its edges and indices, so it is dropped or built
+     * again for g, with the engine chosen before.
+     */
+    void attachGraph(Graph<int>* g);
+
+    /**
+     * @brief Time dependent route through the stops in order, following the restrictions already in the mask.
+     *
+     * @param departure Time at which sNode is left.
+     * @param path Filled with the ids of the vertices on the route.
+     * @return The total time of the route, -1 if some leg has no path.
+     */
+    double timeDependentRoute(Vertex<int>* sNode, const std::vector<Vertex<int>*>& stops, Vertex<int>* dNode, double departure, Graph<int>* g, std::vector<int>& path);
+
+    /**
+     * @brief Turns result into a Timeout result if the budget of its query ran out, partial searches can't be trusted.
+     *
+     * @return true if it did, the result must then not be cached.
+     */
+    bool stopResult(const QueryBudget& budget, QueryResult& result);
+
+    /**
+     * @brief Whether a driving route from sNode through every stop to dNode may exist, by the component labels.
+     *
+     * O(|stops|) time complexity.
+     */
+    bool mayDrive(Vertex<int>* sNode, const std::vector<Vertex<int>*>& stops, Vertex<int>* dNode);
+
+    /**
+     * @brief Whether some car park with free spaces, other than sNode and dNode, may be driven to from sNode and
+     * walked between with dNode, by the component labels.
+     *
+     * @param toDest Walking from the car park to dNode, otherwise from dNode to it (the direction of the eco search).
+     *
+     * O(P) time complexity, where P is the amount of car parks.
+     */
+    bool mayPark(Vertex<int>* sNode, Vertex<int>* dNode, bool toDest);
+
+    /* Methods that run the searches for the result methods above, called only on cache misses */
+
+    void computeIndependentResult(Vertex<int>* sNode, Vertex<int>* dNode, Graph<int>* g, QueryResult& result, double departure);
+    void computeRestrictedResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, const std::vector<Vertex<int>*>& waypoints, bool anyOrder, Graph<int>* g, QueryResult& result, double departure);
+    void computeEcoResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, const double& maxWalkTime, const bool& aprox, Graph<int>* g, QueryResult& result);
+    void computeParetoResult(Vertex<int>* sNode, Vertex<int>* dNode, std::vector<Vertex<int>*>& nAvoid, std::vector<Edge<int>*>& eAvoid, Graph<int>* g, QueryResult& result);
+
+    //* Fills a found driving route with its path (vertex ids) and total time
+    void setDrivingRoute(QueryResult::Route& route, const std::vector<int>& path, double dist);
+    //* Fills an eco route through parking from drivePath, walkPath and the driving distance left on parking
+    void setEcoRoute(QueryResult::Route& route, Vertex<int>* parking, double walkTime);
+
+    /* Methods Meant for use in the interactive Menu */
 
     /**
      * @brief Handles the independent route planning functionality in the command-line interface.
@@ -0,0 +1,278 @@
+#include "ContractionHierarchy.h"
+#include "Parallel.h"
+#include <functional>
+#include <queue>
+#include <set>
+#include <utility>
+using namespace std;
+
+void CustomizableCH::build(Graph<int>* g) {
+    graph = g;
+    vertices = g->getVertexSet();
+    int n = vertices.size();
+
+    //* Undirected topology, every edge counts regardless of its current weights
+    vector<set<int>> neighbours(n);
+    for (Vertex<int>* v : vertices) {
+        for (Edge<int>* e : v->getAdj()) {
+            int a = v->getIndex(), b = e->getDest()->getIndex();
+            if (a == b) continue;
+            neighbours[a].insert(b);
+            neighbours[b].insert(a);
+        }
+    }
+
+    //* Minimum degree elimination, contracting a vertex connects all of its remaining neighbours (fill-in)
+    rank.assign(n, -1);
+    vector<vector<int>> higher(n);
+    priority_queue<pair<size_t, int>, vector<pair<size_t, int>>, greater<pair<size_t, int>>> pq;
+    for (int v = 0; v < n; v++) pq.push(make_pair(neighbours[v].size(), v));
+    int next = 0;
+    while (!pq.empty()) {
+        int v = pq.top().second;
+        size_t degree = pq.top().first;
+        pq.pop();
+        if (rank[v] != -1 || degree != neighbours[v].size()) continue; // outdated entry
+        rank[v] = next++;
+        higher[v].assign(neighbours[v].begin(), neighbours[v].end());
+        for (int u : higher[v]) neighbours[u].erase(v);
+        for (size_t i = 0; i < higher[v].size(); i++) {
+            for (size_t j = i + 1; j < higher[v].size(); j++) {
+                if (neighbours[higher[v][i]].insert(higher[v][j]).second) {
+                    neighbours[higher[v][j]].insert(higher[v][i]);
+                }
+            }
+        }
+        for (int u : higher[v]) pq.push(make_pair(neighbours[u].size(), u));
+        neighbours[v].clear();
+    }
+
+    //* Arcs from each vertex to its higher neighbours, sorted by rank so they can be binary searched
+    arcFirst.assign(n + 1, 0);
+    arcTail.clear();
+    arcHead.clear();
+    for (int v = 0; v < n; v++) {
+        sort(higher[v].begin(), higher[v].end(), [this](int a, int b) { return rank[a] < rank[b]; });
+        arcFirst[v] = arcTail.size();
+        for (int u : higher[v]) {
+            arcTail.push_back(v);
+            arcHead.push_back(u);
+        }
+    }
+    arcFirst[n] = arcTail.size();
+    int m = arcTail.size();
+
+    //* Lower triangles: every pair of higher neighbours of v closes a triangle with the arc between them
+    vector<pair<int, Triangle>> found;
+    for (int v = 0; v < n; v++) {
+        for (int i = arcFirst[v]; i < arcFirst[v + 1]; i++) {
+            for (int j = i + 1; j < arcFirst[v + 1]; j++) {
+                found.push_back(make_pair(findArc(arcHead[i], arcHead[j]), Triangle{ i, j }));
+            }
+        }
+    }
+    triangleFirst.assign(m + 1, 0);
+    for (const pair<int, Triangle>& t : found) triangleFirst[t.first + 1]++;
+    for (int a = 0; a < m; a++) triangleFirst[a + 1] += triangleFirst[a];
+    triangles.assign(found.size(), Triangle{ -1, -1 });
+    vector<int> position(triangleFirst.begin(), triangleFirst.end() - 1);
+    for (const pair<int, Triangle>& t : found) triangles[position[t.first]++] = t.second;
+
+    //* Level of a vertex is one more than the highest level of its lower neighbours
+    vector<int> byRank(n), level(n, 0);
+    for (int v = 0; v < n; v++) byRank[rank[v]] = v;
+    int levels = 0;
+    for (int v : byRank) {
+        for (int a = arcFirst[v]; a < arcFirst[v + 1]; a++) {
+            level[arcHead[a]] = max(level[arcHead[a]], level[v] + 1);
+        }
+        levels = max(levels, level[v] + 1);
+    }
+    levelFirst.assign(levels + 1, 0);
+    for (int a = 0; a < m; a++) levelFirst[level[arcTail[a]] + 1]++;
+    for (int l = 0; l < levels; l++) levelFirst[l + 1] += levelFirst[l];
+    levelArcs.assign(m, 0);
+    position.assign(levelFirst.begin(), levelFirst.end() - 1);
+    for (int a = 0; a < m; a++) levelArcs[position[level[arcTail[a]]]++] = a;
+
+    originalEdges.clear();
+    originalArc.clear();
+    for (Vertex<int>* v : vertices) {
+        for (Edge<int>* e : v->getAdj()) {
+            int a = v->getIndex(), b = e->getDest()->getIndex();
+            if (a == b) continue;
+            originalEdges.push_back(e);
+            originalArc.push_back(rank[a] < rank[b] ? findArc(a, b) : findArc(b, a));
+        }
+    }
+
+    forwardDist.assign(n, INF);
+    backwardDist.assign(n, INF);
+    forwardArc.assign(n, -1);
+    backwardArc.assign(n, -1);
+    touched.clear();
+    built = true;
+    customized = false;
+}
+
+int CustomizableCH::findArc(int lower, int upper) const {
+    auto first = arcHead.begin() + arcFirst[lower], last = arcHead.begin() + arcFirst[lower + 1];
+    auto it = lower_bound(first, last, upper, [this](int a, int b) { return rank[a] < rank[b]; });
+    return (it != last && *it == upper) ? it - arcHead.begin() : -1;
+}
+
+void CustomizableCH::customize(Distance d, unsigned threads) {
+    metric = d;
+    int m = arcTail.size();
+    up.assign(m, INF);
+    down.assign(m, INF);
+    upVia.assign(m, -1);
+    downVia.assign(m, -1);
+    upEdge.assign(m, nullptr);
+    downEdge.assign(m, nullptr);
+
+    shared_ptr<const EdgeWeights> weights = graph->getWeights();
+    for (size_t i = 0; i < originalEdges.size(); i++) {
+        Edge<int>* e = originalEdges[i];
+        int a = originalArc[i];
+        double w = (d == Distance::drive) ? weights->driveTime(e->getIndex()) : weights->walkTime(e->getIndex());
+        if (arcTail[a] == e->getOrig()->getIndex()) {
+            if (w < up[a]) {
+                up[a] = w;
+                upEdge[a] = e;
+            }
+        }
+        else if (w < down[a]) {
+            down[a] = w;
+            downEdge[a] = e;
+        }
+    }
+
+    //* The triangles of an arc only use arcs of lower levels, so every arc of a level can be done at once
+    for (size_t l = 0; l + 1 < levelFirst.size(); l++) {
+        int begin = levelFirst[l];
+        parallelFor(levelFirst[l + 1] - begin, threads, [&](size_t from, size_t to, unsigned) {
+            for (size_t i = from; i < to; i++) {
+                int a = levelArcs[begin + i];
+                for (int t = triangleFirst[a]; t < triangleFirst[a + 1]; t++) {
+                    const Triangle& tri = triangles[t];
+                    double upward = down[tri.lower] + up[tri.upper]; // lower end -> middle -> upper end
+                    double downward = down[tri.upper] + up[tri.lower]; // upper end -> middle -> lower end
+                    if (upward < up[a]) {
+                        up[a] = upward;
+                        upVia[a] = t;
+                    }
+                    if (downward < down[a]) {
+                        down[a] = downward;
+                        downVia[a] = t;
+                    }
+                }
+            }
+        });
+    }
+    customizedVersion = weights->getVersion();
+    customized = true;
+}
+
+double CustomizableCH::query(Vertex<int>* origin, Vertex<int>* dest, vector<int>& res, vector<Edge<int>*>* edges) {
+    res.clear();
+    if (edges) edges->clear();
+    if (!built || origin == nullptr || dest == nullptr) return -1;
+
+    for (int v : touched) {
+        forwardDist[v] = backwardDist[v] = INF;
+        forwardArc[v] = backwardArc[v] = -1;
+    }
+    touched.clear();
+
+    typedef pair<double, int> Item;
+    priority_queue<Item, vector<Item>, greater<Item>> forward, backward;
+    int s = origin->getIndex(), t = dest->getIndex();
+    forwardDist[s] = 0;
+    backwardDist[t] = 0;
+    touched.push_back(s);
+    touched.push_back(t);
+    forward.push(Item(0, s));
+    backward.push(Item(0, t));
+
+    //* Both searches only go up, the one with the smallest key advances until no key can improve the best meeting point
+    double best = INF;
+    int meet = -1;
+    while (!forward.empty() || !backward.empty()) {
+        bool isForward = backward.empty() || (!forward.empty() && forward.top().first <= backward.top().first);
+        priority_queue<Item, vector<Item>, greater<Item>>& q = isForward ? forward : backward;
+        vector<double>& dist = isForward ? forwardDist : backwardDist;
+        vector<int>& arc = isForward ? forwardArc : backwardArc;
+        const vector<double>& weight = isForward ? up : down;
+        Item item = q.top();
+        if (item.first >= best) break;
+        q.pop();
+        int v = item.second;
+        if (item.first > dist[v]) continue; // outdated entry
+        if (forwardDist[v] + backwardDist[v] < best) {
+            best = forwardDist[v] + backwardDist[v];
+            meet = v;
+        }
+        for (int a = arcFirst[v]; a < arcFirst[v + 1]; a++) {
+            int u = arcHead[a];
+            if (weight[a] == INF || dist[v] + weight[a] >= dist[u]) continue;
+            if (forwardDist[u] == INF && backwardDist[u] == INF) touched.push_back(u);
+            dist[u] = dist[v] + weight[a];
+            arc[u] = a;
+            q.push(Item(dist[u], u));
+        }
+    }
+    if (meet == -1) return -1;
+
+    vector<int> upArcs;
+    for (int v = meet; v != s; v = arcTail[forwardArc[v]]) upArcs.push_back(forwardArc[v]);
+    vector<Edge<int>*> path;
+    for (auto it = upArcs.rbegin(); it != upArcs.rend(); it++) unpack(*it, true, path);
+    for (int v = meet; v != t; v = arcTail[backwardArc[v]]) unpack(backwardArc[v], false, path);
+
+    res.push_back(origin->getInfo());
+    for (Edge<int>* e : path) res.push_back(e->getDest()->getInfo());
+    if (edges) edges->swap(path);
+    return best;
+}
+
+void CustomizableCH::unpack(int arc, bool upward, vector<Edge<int>*>& path) const {
+    vector<pair<int, bool>> stack;
+    stack.push_back(make_pair(arc, upward));
+    while (!stack.empty()) {
+        int a = stack.back().first;
+        bool isUp = stack.back().second;
+        stack.pop_back();
+        int via = isUp ? upVia[a] : downVia[a];
+        if (via == -1) {
+            path.push_back(isUp ? upEdge[a] : downEdge[a]);
+            continue;
+        }
+        //* pushed in reverse, the first half of the shortcut must come out first
+        const Triangle& tri = triangles[via];
+        if (isUp) {
+            stack.push_back(make_pair(tri.upper, true));
+            stack.push_back(make_pair(tri.lower, false));
+        }
+        else {
+            stack.push_back(make_pair(tri.lower, true));
+            stack.push_back(make_pair(tri.upper, false));
+        }
+    }
+}
+
+bool CustomizableCH::isBuilt() const {
+    return built;
+}
+
+bool CustomizableCH::needsCustomization(Distance distance) const {
+    return !customized || metric != distance || customizedVersion != graph->getVersion();
+}
+
+Distance CustomizableCH::getMetric() const {
+    return metric;
+}
+
+int CustomizableCH::getRank(int index) const {
+    return rank[index];
+}
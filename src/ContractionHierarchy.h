@@ -0,0 +1,105 @@
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include <vector>
+#include <Graph.h>
+#include "ShortestPathAlgorithms.h"
+
+/**
+ * @brief Customizable Contraction Hierarchy (CCH) over a Graph<int>.
+ *
+ * Preprocessing is split in two phases:
+ * - build: metric independent, uses only the topology of the graph. Vertices are ordered by a minimum degree
+ *   elimination, every vertex is contracted in that order adding the needed shortcuts (fill-in), and the
+ *   lower triangles of every arc are recorded. It only has to run again if vertices or edges are added.
+ * - customize: applies the current edge weights of a metric to every arc, triangle by triangle. Arcs are
+ *   processed level by level of their lower vertex, and the arcs of the same level are split between threads.
+ *
+ * Queries are bidirectional upward searches whose shortcuts are unpacked back to the original edges, so they
+ * give the same vertex sequence format as getPath.
+ *
+ * Queries use internal buffers, so a single instance must not be queried by several threads at once.
+ */
+class CustomizableCH
+{
+public:
+    /**
+     * @brief Computes the vertex order, the shortcuts and the triangles from the topology of g.
+     *
+     * Every edge counts, including edges that can't currently be driven, since a new metric may change that.
+     *
+     * O(sum of d(v)^2) time complexity, where d(v) is the amount of higher neighbours of v after contraction.
+     */
+    void build(Graph<int>* g);
+
+    /**
+     * @brief Applies the current weights of the given metric to every arc.
+     *
+     * @param distance Decides between using Driving times or Walking times.
+     * @param threads Amount of threads to use, 0 uses every hardware thread.
+     *
+     * O(|E| + T) time complexity, where T is the amount of triangles, split between the threads.
+     */
+    void customize(Distance distance, unsigned threads = 0);
+
+    /**
+     * @brief Shortest path from origin to dest with the customized weights.
+     *
+     * @param origin Pointer to the origin vertex.
+     * @param dest Pointer to the destination vertex.
+     * @param res Filled with the ids of the vertices on the path, from origin to dest.
+     * @param edges If not nullptr, filled with the original edges of the path, in order.
+     * @return The total distance of the path, -1 if there is no path.
+     *
+     * O(S log S + P) time complexity, where S is the size of the upward search spaces and P the path length.
+     */
+    double query(Vertex<int>* origin, Vertex<int>* dest, std::vector<int>& res, std::vector<Edge<int>*>* edges = nullptr);
+
+    bool isBuilt() const;
+    //* True if customize was never called for this metric or the graph weights changed since
+    bool needsCustomization(Distance distance) const;
+    Distance getMetric() const;
+    //* Position of the vertex with the given index in the contraction order, higher is more important
+    int getRank(int index) const;
+
+private:
+    struct Triangle
+    {
+        int lower; //* arc from the middle vertex to the lower end of the arc
+        int upper; //* arc from the middle vertex to the upper end of the arc
+    };
+
+    Graph<int>* graph = nullptr;
+    bool built = false, customized = false;
+    unsigned long customizedVersion = 0;
+    Distance metric = Distance::drive;
+
+    std::vector<Vertex<int>*> vertices;
+    std::vector<int> rank;
+
+    //* arcs from every vertex to its higher ranked neighbours, grouped by the lower vertex
+    std::vector<int> arcFirst, arcTail, arcHead;
+    std::vector<Triangle> triangles;
+    std::vector<int> triangleFirst;
+    //* arcs grouped by the level of their lower vertex, to customize each group in parallel
+    std::vector<int> levelArcs, levelFirst;
+    //* original edges and the arc they belong to
+    std::vector<Edge<int>*> originalEdges;
+    std::vector<int> originalArc;
+
+    //* customized weights, up goes from the lower to the upper vertex and down the other way
+    std::vector<double> up, down;
+    //* how each direction unpacks: the triangle it came from, or -1 and the original edge
+    std::vector<int> upVia, downVia;
+    std::vector<Edge<int>*> upEdge, downEdge;
+
+    //* query buffers
+    std::vector<double> forwardDist, backwardDist;
+    std::vector<int> forwardArc, backwardArc;
+    std::vector<int> touched;
+
+    int findArc(int lower, int upper) const;
+    void unpack(int arc, bool upward, std::vector<Edge<int>*>& path) const;
+};
+
+#endif //CONTRACTION_HIERARCHY_H
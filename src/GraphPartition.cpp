@@ -0,0 +1,208 @@
+#include "GraphPartition.h"
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <utility>
+using namespace std;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The region files are little endian and are read in place"
+#endif
+
+void GraphPartition::build(const Graph<int>* g, unsigned regionSize) {
+    vector<Vertex<int>*> vertices(g->getCodeVertex());
+    for (Vertex<int>* v : g->getVertexSet()) vertices[v->getIndex()] = v;
+    int n = vertices.size();
+    if (regionSize == 0) regionSize = 1;
+    region.assign(n, -1);
+    local.assign(n, 0);
+    regions.clear();
+    boundaries.clear();
+
+    vector<int> grown;
+    for (int seed = 0; seed < n; seed++) {
+        if (region[seed] != -1) continue;
+        int r = regions.size();
+        grown.assign(1, seed);
+        region[seed] = r;
+        for (size_t head = 0; head < grown.size() && grown.size() < regionSize; head++) {
+            Vertex<int>* v = vertices[grown[head]];
+            auto visit = [&](Vertex<int>* w) {
+                if (grown.size() < regionSize && region[w->getIndex()] == -1) {
+                    region[w->getIndex()] = r;
+                    grown.push_back(w->getIndex());
+                }
+            };
+            for (Edge<int>* e : v->getAdj()) visit(e->getDest());
+            for (Edge<int>* e : v->getIncoming()) visit(e->getOrig());
+        }
+        regions.push_back(grown);
+    }
+
+    //* boundary vertices first, each group in the order the region was grown
+    for (vector<int>& members : regions) {
+        vector<int> inner, outer;
+        for (int index : members) {
+            bool boundary = false;
+            for (Edge<int>* e : vertices[index]->getAdj()) boundary |= region[e->getDest()->getIndex()] != region[index];
+            for (Edge<int>* e : vertices[index]->getIncoming()) boundary |= region[e->getOrig()->getIndex()] != region[index];
+            (boundary ? outer : inner).push_back(index);
+        }
+        boundaries.push_back(outer.size());
+        members = outer;
+        members.insert(members.end(), inner.begin(), inner.end());
+        for (size_t i = 0; i < members.size(); i++) local[members[i]] = i;
+    }
+}
+
+template <class T>
+static void appendRaw(string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+static void appendArray(string& out, const vector<T>& values) {
+    out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+static void padTo8(string& out) {
+    out.append((8 - out.size() % 8) % 8, '\0');
+}
+
+static bool writeFile(const string& filename, const string& contents) {
+    ofstream file(filename, ios::out | ios::binary);
+    if (!file.is_open() || !file.write(contents.data(), contents.size())) {
+        cerr << "Error occurred when writing " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+int GraphPartition::write(const Graph<int>* g, const string& directory) const {
+    using namespace RegionFormat;
+    vector<Vertex<int>*> vertices(g->getCodeVertex());
+    for (Vertex<int>* v : g->getVertexSet()) vertices[v->getIndex()] = v;
+    string prefix = directory.empty() || directory.back() == '/' ? directory : directory + "/";
+
+    vector<uint32_t> boundaryOffsets(1, 0), boundary, cutOffsets(1, 0);
+    vector<uint64_t> cliqueOffsets(1, 0);
+    vector<double> cliques[2];
+    vector<CutEdge> cutEdges;
+    vector<double> dist;
+    vector<int> parent;
+    for (int r = 0; r < regionCount(); r++) {
+        const vector<int>& members = regions[r];
+        //* the inner edges of the region, in the layout of its file
+        vector<uint32_t> indices(members.begin(), members.end()), offsets(1, 0), targets;
+        vector<int32_t> ids;
+        vector<double> weights[2];
+        for (int index : members) {
+            ids.push_back(vertices[index]->getInfo());
+            for (Edge<int>* e : vertices[index]->getAdj()) {
+                int w = e->getDest()->getIndex();
+                if (region[w] != r) {
+                    cutEdges.push_back({ (uint32_t)w, 0, e->getWalkTime(), e->getDriveTime() });
+                    continue;
+                }
+                targets.push_back(local[w]);
+                weights[0].push_back(e->getWalkTime());
+                weights[1].push_back(e->getDriveTime());
+            }
+            offsets.push_back(targets.size());
+            if (local[index] < boundaries[r]) {
+                boundary.push_back(index);
+                cutOffsets.push_back(cutEdges.size());
+            }
+        }
+
+        RegionView view;
+        view.vertexCount = members.size();
+        view.indices = indices.data();
+        view.ids = ids.data();
+        view.offsets = offsets.data();
+        view.targets = targets.data();
+        view.weights[0] = weights[0].data();
+        view.weights[1] = weights[1].data();
+        int b = boundaries[r];
+        for (int metric = 0; metric < 2; metric++) {
+            for (int i = 0; i < b; i++) {
+                regionDijkstra(view, i, metric, dist, parent);
+                cliques[metric].insert(cliques[metric].end(), dist.begin(), dist.begin() + b);
+            }
+        }
+        boundaryOffsets.push_back(boundaryOffsets.back() + b);
+        cliqueOffsets.push_back(cliqueOffsets.back() + (uint64_t)b * b);
+
+        string file;
+        RegionHeader header = {};
+        memcpy(header.magic, regionMagic, sizeof(header.magic));
+        header.version = version;
+        header.region = r;
+        header.vertexCount = members.size();
+        header.edgeCount = targets.size();
+        header.boundaryCount = b;
+        appendRaw(file, header);
+        appendArray(file, indices);
+        appendArray(file, ids);
+        appendArray(file, offsets);
+        appendArray(file, targets);
+        padTo8(file);
+        appendArray(file, weights[0]);
+        appendArray(file, weights[1]);
+        if (!writeFile(prefix + "region" + to_string(r) + ".bin", file)) return 1;
+    }
+
+    string file;
+    OverlayHeader header = {};
+    memcpy(header.magic, overlayMagic, sizeof(header.magic));
+    header.version = version;
+    header.vertexCount = vertices.size();
+    header.regionCount = regionCount();
+    header.boundaryCount = boundaryOffsets.back();
+    header.cutEdgeCount = cutEdges.size();
+    header.cliqueSize = cliqueOffsets.back();
+    appendRaw(file, header);
+    appendArray(file, vector<uint32_t>(region.begin(), region.end()));
+    appendArray(file, vector<uint32_t>(local.begin(), local.end()));
+    appendArray(file, boundaryOffsets);
+    appendArray(file, boundary);
+    appendArray(file, cutOffsets);
+    padTo8(file);
+    appendArray(file, cliqueOffsets);
+    appendArray(file, cliques[0]);
+    appendArray(file, cliques[1]);
+    appendArray(file, cutEdges);
+    return writeFile(prefix + "overlay.bin", file) ? 0 : 1;
+}
+
+namespace RegionFormat
+{
+
+void regionDijkstra(const RegionView& view, int source, int metric, vector<double>& dist, vector<int>& parent) {
+    dist.assign(view.vertexCount, INF);
+    parent.assign(view.vertexCount, -1);
+    const double* weights = view.weights[metric];
+    typedef pair<double, int> Item;
+    priority_queue<Item, vector<Item>, greater<Item>> q;
+    dist[source] = 0;
+    q.push(Item(0, source));
+    while (!q.empty()) {
+        Item item = q.top();
+        q.pop();
+        int v = item.second;
+        if (item.first > dist[v]) continue; // outdated entry
+        for (uint32_t i = view.offsets[v]; i < view.offsets[v + 1]; i++) {
+            if (weights[i] == INF) continue;
+            int w = view.targets[i];
+            if (dist[v] + weights[i] < dist[w]) {
+                dist[w] = dist[v] + weights[i];
+                parent[w] = v;
+                q.push(Item(dist[w], w));
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,133 @@
+#ifndef GRAPH_PARTITION_H
+#define GRAPH_PARTITION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <Graph.h>
+
+//* Most vertices a region of a GraphPartition holds
+#ifndef PARTITION_REGION_SIZE
+#define PARTITION_REGION_SIZE 256
+#endif
+
+/**
+ * @brief Splits the vertices of a graph into regions of at most a given size, each grown breadth first (following
+ * edges in both directions) from the lowest index not in a region yet, so regions are connected pieces of the map.
+ *
+ * Boundary (overlay) vertices are the ones with an edge to or from another region. The vertices of every region are
+ * kept boundary first, so the local index of a vertex (its position in its region) is below the amount of boundary
+ * vertices of the region exactly when it is one of them.
+ */
+class GraphPartition
+{
+public:
+    /**
+     * @brief Partitions g.
+     *
+     * O(|V| + |E|) time complexity.
+     */
+    void build(const Graph<int>* g, unsigned regionSize = PARTITION_REGION_SIZE);
+
+    int regionCount() const { return regions.size(); }
+    int regionOf(int index) const { return region[index]; }
+    //* Position of the vertex with the given index in the vertices of its region
+    int localIndex(int index) const { return local[index]; }
+    //* Indices of the vertices of a region, boundary vertices first
+    const std::vector<int>& regionVertices(int r) const { return regions[r]; }
+    int boundaryCount(int r) const { return boundaries[r]; }
+    bool isBoundary(int index) const { return local[index] < boundaries[region[index]]; }
+
+    /**
+     * @brief Writes the partitioned graph as binary files in directory (which must exist): overlay.bin with the
+     * partition, the boundary vertices, the edges between regions and the overlay distances, and region<r>.bin with
+     * the vertices and inner edges of region r. See RegionStore for the layout and how they are read.
+     *
+     * The overlay distances of a region are the shortest walking and driving times between every pair of its boundary
+     * vertices using only its inner edges, so a search can cross a region without loading it.
+     *
+     * @return 0 on success, 1 if a file could not be written.
+     *
+     * O(R B (E_R + V_R) log V_R) time complexity, where B is the largest amount of boundary vertices of a region and
+     * V_R and E_R the size of the largest region.
+     */
+    int write(const Graph<int>* g, const std::string& directory) const;
+
+private:
+    std::vector<int> region, local, boundaries;
+    std::vector<std::vector<int>> regions;
+};
+
+namespace RegionFormat
+{
+    const char overlayMagic[4] = { 'O', 'V', 'L', '1' };
+    const char regionMagic[4] = { 'R', 'G', 'N', '1' };
+    const uint32_t version = 1;
+
+    /**
+     * overlay.bin: OverlayHeader, then uint32_t arrays region[vertexCount], local[vertexCount],
+     * boundaryOffsets[regionCount + 1] (the boundary vertices of region r are its local indices
+     * [0, boundaryOffsets[r + 1] - boundaryOffsets[r])), boundary[boundaryCount] (the index of every boundary vertex by its
+     * global boundary position, boundaryOffsets[r] + local index), cutOffsets[boundaryCount + 1] (the edges leaving the boundary vertex
+     * at global boundary position p are cut edges [cutOffsets[p], cutOffsets[p + 1])), padded to 8 bytes, then
+     * cliqueOffsets[regionCount + 1] (uint64_t, the b x b overlay distances of region r, row by row from the boundary vertex),
+     * the overlay walking and then driving distances (double, INF if none), and the cut edges.
+     */
+    struct OverlayHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t regionCount;
+        uint32_t boundaryCount;
+        uint32_t cutEdgeCount;
+        uint64_t cliqueSize; //* overlay distances of each metric
+    };
+
+    struct CutEdge
+    {
+        uint32_t target; //* index of the vertex in another region
+        uint32_t reserved;
+        double walkTime;
+        double driveTime; //* INF if it can't be driven
+    };
+
+    /**
+     * region<r>.bin: RegionHeader, then the arrays indices[vertexCount] (of the vertices by local index),
+     * ids[vertexCount] (int32_t), offsets[vertexCount + 1] and targets[edgeCount] (local indices), padded to 8 bytes, then
+     * the walking and the driving times of the edges (double). The edges of local vertex v are [offsets[v], offsets[v + 1]).
+     */
+    struct RegionHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t region;
+        uint32_t vertexCount;
+        uint32_t edgeCount;
+        uint32_t boundaryCount;
+    };
+
+    //* The inner edges of a region, either in memory or in a mapped file
+    struct RegionView
+    {
+        uint32_t vertexCount = 0;
+        const uint32_t* indices = nullptr;
+        const int32_t* ids = nullptr;
+        const uint32_t* offsets = nullptr;
+        const uint32_t* targets = nullptr;
+        const double* weights[2] = { nullptr, nullptr }; //* by metric, walking then driving as in Distance
+    };
+
+    /**
+     * @brief Dijkstra from a local vertex over the inner edges of a region.
+     *
+     * @param metric 0 for walking times, 1 for driving times.
+     * @param dist Filled with the distance of every local vertex, INF if not reached.
+     * @param parent Filled with the local vertex each one is reached from, -1 for the source and unreached vertices.
+     *
+     * O((E_R + V_R) log V_R) time complexity.
+     */
+    void regionDijkstra(const RegionView& view, int source, int metric, std::vector<double>& dist, std::vector<int>& parent);
+}
+
+#endif //GRAPH_PARTITION_H
@@ -0,0 +1,344 @@
+#include "HubLabels.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <utility>
+using namespace std;
+using namespace HubLabelFormat;
+
+#if HUB_LABELS_SIMD && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HUB_LABELS_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The labels files are little endian and are read in place"
+#endif
+
+template <class T>
+static void appendArray(string& out, const vector<T>& values) {
+    out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+void HubLabels::build(Graph<int>* g, const CustomizableCH& ch, Distance distance) {
+    clear();
+    vector<Vertex<int>*> vertices(g->getCodeVertex());
+    for (Vertex<int>* v : g->getVertexSet()) vertices[v->getIndex()] = v;
+    int n = vertices.size();
+    auto weight = [distance](Edge<int>* e) { return distance == Distance::drive ? e->getDriveTime() : e->getWalkTime(); };
+
+    //* the most important vertex of the hierarchy is hub 0
+    vector<int> order(n);
+    for (int v = 0; v < n; v++) order[n - 1 - ch.getRank(v)] = v;
+
+    //* by direction, out labels are filled by the searches towards each hub and in labels by the ones from it
+    vector<vector<uint32_t>> labelHubs[2] = { vector<vector<uint32_t>>(n), vector<vector<uint32_t>>(n) };
+    vector<vector<double>> labelDists[2] = { vector<vector<double>>(n), vector<vector<double>>(n) };
+    vector<double> dist(n, INF), hubDist(n, INF);
+    vector<int> touched;
+    typedef pair<double, int> Item;
+    for (int k = 0; k < n; k++) {
+        int h = order[k];
+        for (int forward = 1; forward >= 0; forward--) {
+            //* a search from h fills the in labels of what it reaches, one towards h the out labels, and skips
+            //* the vertices the labels of the hubs before h already give the distance of
+            int own = forward ? 0 : 1, filled = 1 - own;
+            for (size_t i = 0; i < labelHubs[own][h].size(); i++) hubDist[labelHubs[own][h][i]] = labelDists[own][h][i];
+            priority_queue<Item, vector<Item>, greater<Item>> q;
+            dist[h] = 0;
+            touched.push_back(h);
+            q.push(Item(0, h));
+            while (!q.empty()) {
+                Item item = q.top();
+                q.pop();
+                int u = item.second;
+                if (item.first > dist[u]) continue; // outdated entry
+                double known = INF;
+                for (size_t i = 0; i < labelHubs[filled][u].size(); i++) {
+                    known = min(known, hubDist[labelHubs[filled][u][i]] + labelDists[filled][u][i]);
+                }
+                if (known <= dist[u]) continue;
+                labelHubs[filled][u].push_back(k);
+                labelDists[filled][u].push_back(dist[u]);
+                for (Edge<int>* e : forward ? vertices[u]->getAdj() : vertices[u]->getIncoming()) {
+                    double w = weight(e);
+                    if (w == INF) continue;
+                    int v = (forward ? e->getDest() : e->getOrig())->getIndex();
+                    if (dist[u] + w < dist[v]) {
+                        if (dist[v] == INF) touched.push_back(v);
+                        dist[v] = dist[u] + w;
+                        q.push(Item(dist[v], v));
+                    }
+                }
+            }
+            for (int v : touched) dist[v] = INF;
+            touched.clear();
+            for (uint32_t hub : labelHubs[own][h]) hubDist[hub] = INF;
+        }
+    }
+
+    //* written in the file layout, hubs of every label increase since they were added in order
+    Header header = {};
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = version;
+    header.vertexCount = n;
+    header.edgeCount = g->getEdgeCount();
+    header.metric = distance;
+    buffer.assign(reinterpret_cast<const char*>(&header), sizeof(Header));
+    for (int d = 0; d < 2; d++) {
+        vector<uint64_t> entries(1, 0), bytes(1, 0);
+        vector<double> allDists;
+        string encoded;
+        for (int v = 0; v < n; v++) {
+            uint32_t previous = 0;
+            for (uint32_t hub : labelHubs[d][v]) {
+                uint32_t delta = hub - previous;
+                previous = hub;
+                do {
+                    uint8_t byte = delta & 0x7F;
+                    delta >>= 7;
+                    encoded.push_back(char(delta != 0 ? byte | 0x80 : byte));
+                } while (delta != 0);
+            }
+            allDists.insert(allDists.end(), labelDists[d][v].begin(), labelDists[d][v].end());
+            entries.push_back(allDists.size());
+            bytes.push_back(encoded.size());
+        }
+        appendArray(buffer, entries);
+        appendArray(buffer, bytes);
+        appendArray(buffer, allDists);
+        buffer += encoded;
+        buffer.append((8 - buffer.size() % 8) % 8, '\0');
+        //* the counts go in the header at the start of the buffer
+        Header* written = reinterpret_cast<Header*>(&buffer[0]);
+        written->entryCount[d] = allDists.size();
+        written->byteCount[d] = encoded.size();
+    }
+    data = buffer.data();
+    if (!attach(buffer.size())) clear();
+}
+
+int HubLabels::write(const string& filename) const {
+    ofstream out(filename, ios::out | ios::binary);
+    if (!out.is_open() || !out.write(data, size())) {
+        cerr << "Error occurred when writing " << filename << endl;
+        return 1;
+    }
+    return 0;
+}
+
+bool HubLabels::load(const string& filename) {
+    clear();
+    file.reset(new MappedFile(filename));
+    if (!file->isOpen()) {
+        clear();
+        return false;
+    }
+    data = file->data();
+    if (!attach(file->size())) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool HubLabels::attach(size_t size) {
+    if (size < sizeof(Header)) return false;
+    Header header;
+    memcpy(&header, data, sizeof(Header));
+    if (memcmp(header.magic, magic, sizeof(header.magic)) != 0 || header.version != version) return false;
+    if (header.metric != Distance::drive && header.metric != Distance::walk) return false;
+    uint64_t offset = sizeof(Header);
+    for (int d = 0; d < 2; d++) {
+        uint64_t next = offset + 16 * ((uint64_t)header.vertexCount + 1) + 8 * header.entryCount[d] + header.byteCount[d];
+        next = (next + 7) / 8 * 8;
+        if (next > size) return false;
+        entryFirst[d] = reinterpret_cast<const uint64_t*>(data + offset);
+        byteFirst[d] = entryFirst[d] + header.vertexCount + 1;
+        dists[d] = reinterpret_cast<const double*>(byteFirst[d] + header.vertexCount + 1);
+        hubs[d] = reinterpret_cast<const uint8_t*>(dists[d] + header.entryCount[d]);
+        if (entryFirst[d][header.vertexCount] != header.entryCount[d] || byteFirst[d][header.vertexCount] != header.byteCount[d]) return false;
+        offset = next;
+    }
+    length = offset;
+    vertexCount = header.vertexCount;
+    edgeCount = header.edgeCount;
+    metric = (Distance)header.metric;
+    return true;
+}
+
+void HubLabels::clear() {
+    buffer.clear();
+    buffer.shrink_to_fit();
+    file.reset();
+    data = nullptr;
+    length = 0;
+    vertexCount = edgeCount = 0;
+    for (int d = 0; d < 2; d++) {
+        entryFirst[d] = byteFirst[d] = nullptr;
+        dists[d] = nullptr;
+        hubs[d] = nullptr;
+    }
+}
+
+bool HubLabels::isBuilt() const {
+    return data != nullptr;
+}
+
+bool HubLabels::matches(const Graph<int>* g) const {
+    return isBuilt() && vertexCount == (uint32_t)g->getCodeVertex() && edgeCount == (uint32_t)g->getEdgeCount();
+}
+
+Distance HubLabels::getMetric() const {
+    return metric;
+}
+
+size_t HubLabels::size() const {
+    return length;
+}
+
+void HubLabels::decode(int direction, int v, Label& label) const {
+    uint64_t first = entryFirst[direction][v], last = entryFirst[direction][v + 1];
+    label.hubs.resize(last - first);
+    label.dists = dists[direction] + first;
+    const uint8_t* p = hubs[direction] + byteFirst[direction][v];
+    uint32_t hub = 0;
+    for (uint32_t& h : label.hubs) {
+        uint32_t delta = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            byte = *p++;
+            delta |= uint32_t(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        hub += delta;
+        h = hub;
+    }
+}
+
+double HubLabels::distance(int from, int to) {
+    if (!isBuilt() || from < 0 || to < 0 || (uint32_t)from >= vertexCount || (uint32_t)to >= vertexCount) return INF;
+    decode(0, from, outLabel);
+    decode(1, to, inLabel);
+    return intersect(outLabel.hubs.data(), outLabel.dists, outLabel.hubs.size(), inLabel.hubs.data(), inLabel.dists, inLabel.hubs.size());
+}
+
+void HubLabels::distances(int from, const vector<int>& to, vector<double>& row) {
+    row.assign(to.size(), INF);
+    if (!isBuilt() || from < 0 || (uint32_t)from >= vertexCount) return;
+    decode(0, from, outLabel);
+    for (size_t i = 0; i < to.size(); i++) {
+        if (to[i] < 0 || (uint32_t)to[i] >= vertexCount) continue;
+        decode(1, to[i], inLabel);
+        row[i] = intersect(outLabel.hubs.data(), outLabel.dists, outLabel.hubs.size(), inLabel.hubs.data(), inLabel.dists, inLabel.hubs.size());
+    }
+}
+
+double HubLabels::path(Vertex<int>* origin, Vertex<int>* dest, vector<int>& res, vector<Edge<int>*>* edges) {
+    res.clear();
+    if (edges) edges->clear();
+    if (!isBuilt() || origin == nullptr || dest == nullptr) return -1;
+    auto weight = [this](Edge<int>* e) { return metric == Distance::drive ? e->getDriveTime() : e->getWalkTime(); };
+    decode(1, dest->getIndex(), inLabel);
+    auto toDest = [&](Vertex<int>* v) {
+        if (v == dest) return 0.0;
+        decode(0, v->getIndex(), outLabel);
+        return intersect(outLabel.hubs.data(), outLabel.dists, outLabel.hubs.size(), inLabel.hubs.data(), inLabel.dists, inLabel.hubs.size());
+    };
+    double total = toDest(origin);
+    if (total == INF) return -1;
+
+    //* every step takes the edge that leaves the least distance to go, which is on a shortest path
+    vector<Edge<int>*> path;
+    res.push_back(origin->getInfo());
+    for (Vertex<int>* v = origin; v != dest;) {
+        Edge<int>* next = nullptr;
+        double best = INF;
+        for (Edge<int>* e : v->getAdj()) {
+            if (weight(e) == INF) continue;
+            double rest = weight(e) + toDest(e->getDest());
+            if (rest < best) {
+                best = rest;
+                next = e;
+            }
+        }
+        //* only edges of weight 0 could make it go around, no path is longer than the amount of vertices
+        if (next == nullptr || path.size() >= vertexCount) {
+            res.clear();
+            return -1;
+        }
+        path.push_back(next);
+        v = next->getDest();
+        res.push_back(v->getInfo());
+    }
+    if (edges) edges->swap(path);
+    return total;
+}
+
+namespace HubLabelFormat
+{
+
+typedef double (*IntersectFunction)(const uint32_t*, const double*, size_t, const uint32_t*, const double*, size_t);
+
+double intersectScalar(const uint32_t* a, const double* aDist, size_t na, const uint32_t* b, const double* bDist, size_t nb) {
+    double best = INF;
+    size_t i = 0, j = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) i++;
+        else if (b[j] < a[i]) j++;
+        else {
+            best = min(best, aDist[i] + bDist[j]);
+            i++;
+            j++;
+        }
+    }
+    return best;
+}
+
+#ifdef HUB_LABELS_X86
+__attribute__((target("sse2")))
+static double intersectSse2(const uint32_t* a, const double* aDist, size_t na, const uint32_t* b, const double* bDist, size_t nb) {
+    double best = INF;
+    size_t i = 0, j = 0;
+    //* every hub of a block of a against every hub of a block of b, by comparing with the 4 rotations of the b block,
+    //* then the block with the smallest last hub moves on (both if equal, hubs are unique in a label)
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m128i blockA = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i blockB = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        __m128i equal = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(blockA, blockB), _mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(1, 0, 3, 2))), _mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(2, 1, 0, 3)))));
+        int lanes = _mm_movemask_ps(_mm_castsi128_ps(equal));
+        while (lanes != 0) {
+            int l = __builtin_ctz(lanes);
+            lanes &= lanes - 1;
+            for (int k = 0; k < 4; k++) {
+                if (b[j + k] == a[i + l]) best = min(best, aDist[i + l] + bDist[j + k]);
+            }
+        }
+        uint32_t lastA = a[i + 3], lastB = b[j + 3];
+        if (lastA <= lastB) i += 4;
+        if (lastB <= lastA) j += 4;
+    }
+    return min(best, intersectScalar(a + i, aDist + i, na - i, b + j, bDist + j, nb - j));
+}
+#endif
+
+static IntersectFunction pickIntersect() {
+#ifdef HUB_LABELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) return intersectSse2;
+#endif
+    return intersectScalar;
+}
+
+double intersect(const uint32_t* a, const double* aDist, size_t na, const uint32_t* b, const double* bDist, size_t nb) {
+    static const IntersectFunction chosen = pickIntersect();
+    return chosen(a, aDist, na, b, bDist, nb);
+}
+
+}
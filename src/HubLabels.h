@@ -0,0 +1,158 @@
+#ifndef HUB_LABELS_H
+#define HUB_LABELS_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Graph.h>
+#include "ContractionHierarchy.h"
+#include "MappedFile.h"
+#include "ShortestPathAlgorithms.h"
+
+//* Set to 0 to always intersect labels with the scalar merge
+#ifndef HUB_LABELS_SIMD
+#define HUB_LABELS_SIMD 1
+#endif
+
+/**
+ * @brief Hub labels of one metric of a Graph<int>, for distance lookups without a search.
+ *
+ * Every vertex has an out label (hubs it reaches and their distance) and an in label (hubs reaching it), such that
+ * the shortest distance from u to v is the smallest out[u] + in[v] over the hubs both labels share. Labels are built
+ * by pruned dijkstras from every vertex, the most important first in the order of a Contraction Hierarchy, so the
+ * few important vertices cover most shortest paths and labels stay small.
+ *
+ * The hubs of a label are sorted and stored as variable length deltas, its distances as doubles. The index is kept
+ * in the same layout it is written in, so a file is used in place once loaded, with no graph needed for distances.
+ * Paths are not stored, path follows the edges whose distance to the destination is the shortest on demand.
+ *
+ * The labels hold the weights they were built with, they must be built again when edge weights change.
+ * Queries use internal buffers, so a single instance must not be queried by several threads at once.
+ */
+class HubLabels
+{
+public:
+    /**
+     * @brief Builds the labels of the given metric for g, in the vertex order of ch (which must be built on g).
+     *
+     * O(L (|V| + |E|) log |V|) time complexity, where L is the average label size, with pruning the searches from
+     * less important vertices settle few vertices.
+     */
+    void build(Graph<int>* g, const CustomizableCH& ch, Distance distance);
+
+    /**
+     * @brief Writes the labels to a file, which load reads back.
+     *
+     * @return 0 on success, 1 if the file could not be written.
+     */
+    int write(const std::string& filename) const;
+
+    /**
+     * @brief Maps a file written by write. The labels built or loaded before are dropped.
+     *
+     * @return false if the file is missing or not valid.
+     */
+    bool load(const std::string& filename);
+
+    //* Drops the labels, isBuilt is false afterwards
+    void clear();
+    bool isBuilt() const;
+    //* True if the labels were built for a graph with the vertices and edges of g
+    bool matches(const Graph<int>* g) const;
+    Distance getMetric() const;
+    //* Bytes the labels take, in memory or in the file
+    size_t size() const;
+
+    /**
+     * @brief Shortest distance from the vertex at index from to the one at index to.
+     *
+     * @return The distance, INF if there is no path.
+     *
+     * O(|out[from]| + |in[to]|) time complexity.
+     */
+    double distance(int from, int to);
+
+    /**
+     * @brief Shortest distances from the vertex at index from to the ones at the given indices, the out label of
+     * from is only decoded once.
+     *
+     * @param row Filled with a distance by target, INF if there is no path.
+     */
+    void distances(int from, const std::vector<int>& to, std::vector<double>& row);
+
+    /**
+     * @brief Shortest path from origin to dest in g, the graph the labels were built for.
+     *
+     * @param res Filled with the ids of the vertices on the path, from origin to dest.
+     * @param edges If not nullptr, filled with the original edges of the path, in order.
+     * @return The total distance of the path, -1 if there is no path.
+     *
+     * O(P D Q) time complexity, where P is the length of the path, D the degree of its vertices and Q a distance query.
+     */
+    double path(Vertex<int>* origin, Vertex<int>* dest, std::vector<int>& res, std::vector<Edge<int>*>* edges = nullptr);
+
+private:
+    //* A decoded label, its distances are read in place
+    struct Label
+    {
+        std::vector<uint32_t> hubs;
+        const double* dists = nullptr;
+    };
+
+    std::string buffer; //* the labels built, in the file layout
+    std::unique_ptr<MappedFile> file;
+    const char* data = nullptr;
+    size_t length = 0;
+    uint32_t vertexCount = 0, edgeCount = 0;
+    Distance metric = Distance::drive;
+    //* by direction, 0 for the out labels and 1 for the in labels
+    const uint64_t* entryFirst[2] = { nullptr, nullptr };
+    const uint64_t* byteFirst[2] = { nullptr, nullptr };
+    const double* dists[2] = { nullptr, nullptr };
+    const uint8_t* hubs[2] = { nullptr, nullptr };
+    Label outLabel, inLabel;
+
+    //* Points the arrays at the labels in data, false if the size is not the one the header gives
+    bool attach(size_t size);
+    void decode(int direction, int v, Label& label) const;
+};
+
+namespace HubLabelFormat
+{
+    const char magic[4] = { 'H', 'U', 'B', '1' };
+    const uint32_t version = 1;
+
+    /**
+     * A labels file: Header, then for the out labels and then the in labels uint64_t arrays entryFirst[vertexCount + 1]
+     * (the entries of the label of v are [entryFirst[v], entryFirst[v + 1])) and byteFirst[vertexCount + 1] (the same
+     * for its hub bytes), the distance of every entry (double), and the hubs, padded to 8 bytes. The hubs of a label are
+     * unsigned LEB128 numbers, the first hub then the difference to the one before. Hubs are positions in the order the
+     * labels were built in, 0 the most important vertex.
+     */
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t edgeCount; //* Graph::getEdgeCount of the graph the labels were built for
+        uint32_t metric;    //* a Distance
+        uint32_t reserved;
+        uint64_t entryCount[2];
+        uint64_t byteCount[2];
+    };
+
+    /**
+     * @brief Smallest a[i] + b[j] over a[i] == b[j], INF if the sorted hubs share none. Compares blocks of 4 hubs
+     * with SSE2 when the CPU supports it, chosen once at runtime, and merges one hub at a time otherwise. Both give
+     * exactly the same result.
+     *
+     * O(na + nb) time complexity.
+     */
+    double intersect(const uint32_t* a, const double* aDist, size_t na, const uint32_t* b, const double* bDist, size_t nb);
+
+    //* Same as intersect, always with the scalar merge
+    double intersectScalar(const uint32_t* a, const double* aDist, size_t na, const uint32_t* b, const double* bDist, size_t nb);
+}
+
+#endif //HUB_LABELS_H
@@ -0,0 +1,69 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Read only view of a whole file. The file is memory mapped where mmap is available,
+ * anywhere else (or if mapping fails) it is read into memory once.
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& filename) {
+#ifdef MAPPED_FILE_MMAP
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd != -1) {
+            struct stat info;
+            if (fstat(fd, &info) == 0) {
+                open = true;
+                length = info.st_size;
+                if (length > 0) {
+                    void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (map != MAP_FAILED) {
+                        mapping = static_cast<const char*>(map);
+                        madvise(map, length, MADV_SEQUENTIAL);
+                    }
+                }
+            }
+            ::close(fd);
+            if (!open || length == 0 || mapping != nullptr) return;
+        }
+#endif
+        std::ifstream file(filename, std::ios::binary);
+        open = file.is_open();
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        length = buffer.size();
+    }
+
+    ~MappedFile() {
+#ifdef MAPPED_FILE_MMAP
+        if (mapping != nullptr) munmap(const_cast<char*>(mapping), length);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return open; }
+    const char* data() const { return mapping != nullptr ? mapping : buffer.data(); }
+    size_t size() const { return length; }
+
+private:
+    bool open = false;
+    const char* mapping = nullptr;
+    size_t length = 0;
+    std::string buffer;
+};
+
+#endif //MAPPED_FILE_H
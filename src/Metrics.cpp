@@ -0,0 +1,206 @@
+#include "Metrics.h"
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+using namespace std;
+
+struct Metrics::Shard
+{
+    atomic<uint64_t> counters[COUNTER_COUNT];
+    atomic<uint64_t> queries[QUERY_KIND_COUNT];
+    atomic<uint64_t> failures[QUERY_KIND_COUNT];
+    atomic<uint64_t> latencySum[QUERY_KIND_COUNT]; // nanoseconds
+    atomic<uint64_t> latency[QUERY_KIND_COUNT][BUCKET_COUNT];
+    Shard* next = nullptr;
+
+    Shard() {
+        for (auto& c : counters) c.store(0, memory_order_relaxed);
+        for (int k = 0; k < QUERY_KIND_COUNT; k++) {
+            queries[k].store(0, memory_order_relaxed);
+            failures[k].store(0, memory_order_relaxed);
+            latencySum[k].store(0, memory_order_relaxed);
+            for (auto& b : latency[k]) b.store(0, memory_order_relaxed);
+        }
+    }
+};
+
+atomic<Metrics::Shard*> Metrics::shards{ nullptr };
+
+//* Only the owner thread writes to its shard, so a plain load and store is enough and needs no locked instruction
+static void bump(atomic<uint64_t>& value, uint64_t amount) {
+    value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+Metrics::Shard& Metrics::localShard() {
+    thread_local Shard* shard = nullptr;
+    if (shard == nullptr) {
+        shard = new Shard();
+        Shard* head = shards.load(memory_order_relaxed);
+        do {
+            shard->next = head;
+        } while (!shards.compare_exchange_weak(head, shard, memory_order_release, memory_order_relaxed));
+    }
+    return *shard;
+}
+
+int Metrics::bucketOf(uint64_t nanoseconds) {
+    const uint64_t sub = uint64_t(1) << METRICS_SUB_BITS;
+    if (nanoseconds >= (uint64_t(1) << METRICS_MAX_BITS)) return BUCKET_COUNT - 1;
+    if (nanoseconds < sub) return nanoseconds;
+    int msb = 63;
+    while (!(nanoseconds >> msb)) msb--;
+    int shift = msb - METRICS_SUB_BITS;
+    return (shift + 1) * sub + (int)((nanoseconds >> shift) - sub);
+}
+
+uint64_t Metrics::bucketLimit(int bucket) {
+    const int sub = 1 << METRICS_SUB_BITS;
+    if (bucket < sub) return bucket + 1;
+    int shift = bucket / sub - 1;
+    return (uint64_t(sub + bucket % sub) + 1) << shift;
+}
+
+void Metrics::add(Counter counter, uint64_t amount) {
+    bump(localShard().counters[counter], amount);
+}
+
+void Metrics::recordQuery(QueryKind kind, chrono::nanoseconds latency) {
+    Shard& shard = localShard();
+    uint64_t ns = latency.count() < 0 ? 0 : latency.count();
+    bump(shard.queries[kind], 1);
+    bump(shard.latencySum[kind], ns);
+    bump(shard.latency[kind][bucketOf(ns)], 1);
+}
+
+void Metrics::recordFailure(QueryKind kind) {
+    bump(localShard().failures[kind], 1);
+}
+
+template <class F>
+uint64_t Metrics::total(F field) {
+    uint64_t sum = 0;
+    for (Shard* s = shards.load(memory_order_acquire); s != nullptr; s = s->next) {
+        sum += field(*s).load(memory_order_relaxed);
+    }
+    return sum;
+}
+
+uint64_t Metrics::get(Counter counter) {
+    return total([counter](Shard& s) -> atomic<uint64_t>& { return s.counters[counter]; });
+}
+
+uint64_t Metrics::getQueries(QueryKind kind) {
+    return total([kind](Shard& s) -> atomic<uint64_t>& { return s.queries[kind]; });
+}
+
+uint64_t Metrics::getFailures(QueryKind kind) {
+    return total([kind](Shard& s) -> atomic<uint64_t>& { return s.failures[kind]; });
+}
+
+double Metrics::latencyQuantile(QueryKind kind, double quantile) {
+    vector<uint64_t> merged(BUCKET_COUNT, 0);
+    uint64_t count = 0;
+    for (Shard* s = shards.load(memory_order_acquire); s != nullptr; s = s->next) {
+        for (int b = 0; b < BUCKET_COUNT; b++) {
+            uint64_t c = s->latency[kind][b].load(memory_order_relaxed);
+            merged[b] += c;
+            count += c;
+        }
+    }
+    if (count == 0) return 0;
+    //* rank of the quantile among the recorded values, counting from 1
+    uint64_t rank = (uint64_t)(quantile * count);
+    if (rank < quantile * count || rank == 0) rank++;
+    if (rank > count) rank = count;
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKET_COUNT; b++) {
+        seen += merged[b];
+        if (seen >= rank) return bucketLimit(b) * 1e-9;
+    }
+    return bucketLimit(BUCKET_COUNT - 1) * 1e-9;
+}
+
+static const char* const kindLabels[Metrics::QUERY_KIND_COUNT] = {
+    "mode=\"driving\",kind=\"independent\"",
+    "mode=\"driving\",kind=\"restricted\"",
+    "mode=\"driving-walking\",kind=\"eco\"",
+    "mode=\"driving-walking-pareto\",kind=\"pareto\"",
+};
+
+static void header(ostream& out, const string& name, const string& type, const string& help) {
+    out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << ' ' << type << '\n';
+}
+
+void Metrics::writePrometheus(ostream& out) {
+    const int kinds = QUERY_KIND_COUNT;
+    out << setprecision(9);
+
+    header(out, "route_queries_total", "counter", "Queries answered, result cache hits included.");
+    for (int k = 0; k < kinds; k++) out << "route_queries_total{" << kindLabels[k] << "} " << getQueries((QueryKind)k) << '\n';
+
+    header(out, "route_query_failures_total", "counter", "Queries whose route was none, counted when computed.");
+    for (int k = 0; k < kinds; k++) out << "route_query_failures_total{" << kindLabels[k] << "} " << getFailures((QueryKind)k) << '\n';
+
+    header(out, "route_parse_errors_total", "counter", "Errors reported while parsing batch input.");
+    out << "route_parse_errors_total " << get(parseErrors) << '\n';
+
+    header(out, "route_searches_total", "counter", "Shortest path searches run.");
+    out << "route_searches_total " << get(searches) << '\n';
+
+    header(out, "route_settled_vertices_total", "counter", "Vertices expanded by shortest path searches.");
+    out << "route_settled_vertices_total " << get(settledVertices) << '\n';
+
+    header(out, "route_relaxed_edges_total", "counter", "Edges that improved the distance of their target.");
+    out << "route_relaxed_edges_total " << get(relaxedEdges) << '\n';
+
+    header(out, "route_query_timeouts_total", "counter", "Queries stopped by their deadline, settled vertex budget or cancellation.");
+    out << "route_query_timeouts_total " << get(timeouts) << '\n';
+
+    header(out, "route_query_latency_seconds", "summary", "Time to answer a query, result cache hits included.");
+    const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (int k = 0; k < kinds; k++) {
+        QueryKind kind = (QueryKind)k;
+        for (double q : quantiles) {
+            out << "route_query_latency_seconds{" << kindLabels[k] << ",quantile=\"" << q << "\"} " << latencyQuantile(kind, q) << '\n';
+        }
+        uint64_t sum = total([kind](Shard& s) -> atomic<uint64_t>& { return s.latencySum[kind]; });
+        out << "route_query_latency_seconds_sum{" << kindLabels[k] << "} " << sum * 1e-9 << '\n';
+        out << "route_query_latency_seconds_count{" << kindLabels[k] << "} " << getQueries(kind) << '\n';
+    }
+}
+
+bool Metrics::dump(const string& filename) {
+    string temporary = filename + ".tmp";
+    {
+        ofstream file(temporary);
+        if (!file.is_open()) return false;
+        writePrometheus(file);
+        if (!file) return false;
+    }
+    return rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+MetricsDumper::MetricsDumper(const string& filename, unsigned seconds) : filename(filename), interval(seconds) {
+    worker = thread(&MetricsDumper::run, this);
+}
+
+MetricsDumper::~MetricsDumper() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    Metrics::dump(filename);
+}
+
+void MetricsDumper::run() {
+    unique_lock<mutex> lock(mtx);
+    while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+        lock.unlock();
+        Metrics::dump(filename);
+        lock.lock();
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+//* Latencies are kept in nanoseconds, anything longer than 2^METRICS_MAX_BITS ns (about 18 minutes) goes to the last bucket
+#define METRICS_MAX_BITS 40
+//* 2^METRICS_SUB_BITS buckets per power of two, so every bucket is within about 3% of the values it holds
+#define METRICS_SUB_BITS 5
+
+//* Default seconds between two dumps of MetricsDumper
+#ifndef METRICS_DUMP_INTERVAL
+#define METRICS_DUMP_INTERVAL 10
+#endif
+
+/**
+ * @brief Process wide query statistics, safe to update from any amount of threads without locks.
+ *
+ * Every thread writes to its own shard (counters and latency histograms), created the first time the thread records
+ * something and linked into a list with a compare and swap. Only the owning thread writes to a shard, with relaxed
+ * atomic loads and stores, so updates never wait and never bounce a cache line between threads. Readers add up
+ * every shard, so a read sees each update either whole or not at all but is not a snapshot across counters.
+ * Shards live until the program ends, so nothing is lost when a thread finishes.
+ *
+ * Latencies go to HDR style histograms: exact buckets below 2^METRICS_SUB_BITS ns and then 2^METRICS_SUB_BITS
+ * buckets per power of two, which gives the percentiles with a bounded relative error and O(1) recording.
+ */
+class Metrics
+{
+public:
+    enum Counter
+    {
+        parseErrors,     // input errors reported while parsing a batch
+        searches,        // shortest path searches run (dijkstra kernels and bidirectional searches)
+        settledVertices, // vertices expanded by those searches
+        relaxedEdges,    // edges that improved the distance of their target
+        timeouts,        // queries stopped by their deadline, settled vertex budget or cancellation
+        COUNTER_COUNT,
+    };
+
+    enum QueryKind
+    {
+        independentQuery, // Mode:driving without restrictions
+        restrictedQuery,  // Mode:driving with restrictions
+        ecoQuery,         // Mode:driving-walking
+        paretoQuery,      // Mode:driving-walking-pareto
+        QUERY_KIND_COUNT,
+    };
+
+    static void add(Counter counter, uint64_t amount = 1);
+
+    /**
+     * @brief Records an answered query and the time it took, result cache hits included.
+     *
+     * O(1) time complexity.
+     */
+    static void recordQuery(QueryKind kind, std::chrono::nanoseconds latency);
+
+    /**
+     * @brief Records a query whose result is none (no route within its restrictions). Counted when the result is
+     * computed, a repeated query answered from the result cache is not counted again.
+     */
+    static void recordFailure(QueryKind kind);
+
+    static uint64_t get(Counter counter);
+    static uint64_t getQueries(QueryKind kind);
+    static uint64_t getFailures(QueryKind kind);
+
+    /**
+     * @brief Latency below which the given fraction of the queries of a kind were answered, in seconds.
+     *
+     * @param quantile Between 0 and 1.
+     * @return The upper bound of the histogram bucket holding that quantile, 0 if there were no queries.
+     *
+     * O(B * T) time complexity, where B is the amount of buckets and T the amount of threads that recorded something.
+     */
+    static double latencyQuantile(QueryKind kind, double quantile);
+
+    /**
+     * @brief Writes every metric in the Prometheus text exposition format.
+     */
+    static void writePrometheus(std::ostream& out);
+
+    /**
+     * @brief Writes the metrics to a file, through a temporary file renamed over it so readers never see half a dump.
+     *
+     * @return false if the file could not be written.
+     */
+    static bool dump(const std::string& filename);
+
+    static const int BUCKET_COUNT = (METRICS_MAX_BITS - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS;
+
+private:
+    struct Shard;
+    static std::atomic<Shard*> shards; // every shard ever created, newest first
+    static Shard& localShard();
+    //* Adds up one field over every shard
+    template <class F>
+    static uint64_t total(F field);
+    static int bucketOf(uint64_t nanoseconds);
+    static uint64_t bucketLimit(int bucket);
+};
+
+/**
+ * @brief Dumps the metrics to a file periodically from a background thread, and one last time when destroyed.
+ */
+class MetricsDumper
+{
+public:
+    MetricsDumper(const std::string& filename, unsigned seconds = METRICS_DUMP_INTERVAL);
+    ~MetricsDumper();
+
+    MetricsDumper(const MetricsDumper&) = delete;
+    MetricsDumper& operator=(const MetricsDumper&) = delete;
+
+private:
+    std::string filename;
+    std::chrono::seconds interval;
+    bool stopping = false;
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::thread worker;
+
+    void run();
+};
+
+//* Records the lifetime of a scope as the latency of one query of the given kind
+class QueryTimer
+{
+public:
+    explicit QueryTimer(Metrics::QueryKind kind) : kind(kind), start(std::chrono::steady_clock::now()) {}
+    ~QueryTimer() { Metrics::recordQuery(kind, std::chrono::steady_clock::now() - start); }
+
+private:
+    Metrics::QueryKind kind;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif //METRICS_H
@@ -0,0 +1,346 @@
+#include "MultiLevelOverlay.h"
+#include "Metrics.h"
+#include "Parallel.h"
+#include "QueryBudget.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+using namespace std;
+
+//* Sizes the cliques of every cell of a level, all of them to be customized
+static void prepareCliques(vector<size_t>& cliqueFirst, vector<double>& clique, vector<char>& dirty, const vector<int>& boundaryCount) {
+    cliqueFirst.assign(1, 0);
+    for (int b : boundaryCount) cliqueFirst.push_back(cliqueFirst.back() + (size_t)b * b);
+    clique.assign(cliqueFirst.back(), INF);
+    dirty.assign(boundaryCount.size(), 1);
+}
+
+void MultiLevelOverlay::build(Graph<int>* g, unsigned maxLevels, unsigned cellSize, unsigned fanout) {
+    graph = g;
+    vertices.assign(g->getCodeVertex(), nullptr);
+    for (Vertex<int>* v : g->getVertexSet()) vertices[v->getIndex()] = v;
+    int n = vertices.size();
+
+    GraphPartition partition;
+    partition.build(g, cellSize);
+    levels.assign(1, Level());
+    Level& first = levels[0];
+    first.cell.assign(n, -1);
+    first.node.assign(n, -1);
+    for (int r = 0; r < partition.regionCount(); r++) {
+        first.nodes.push_back(partition.regionVertices(r));
+        first.boundaryCount.push_back(partition.boundaryCount(r));
+        for (size_t i = 0; i < first.nodes[r].size(); i++) {
+            first.cell[first.nodes[r][i]] = r;
+            first.node[first.nodes[r][i]] = i;
+        }
+    }
+    prepareCliques(first.cliqueFirst, first.clique, first.dirty, first.boundaryCount);
+    size_t capacity = max(1u, cellSize);
+    while (levels.size() < max(1u, maxLevels)) {
+        capacity *= max(2u, fanout);
+        if (!addLevel(capacity)) break;
+    }
+
+    dist.assign(n, INF);
+    parent.assign(n, -1);
+    parentEdge.assign(n, nullptr);
+    parentLevel.assign(n, 0);
+    touched.clear();
+    built = true;
+    customized = false;
+    markedChanges = 0;
+}
+
+bool MultiLevelOverlay::addLevel(size_t capacity) {
+    const Level& below = levels.back();
+    int n = vertices.size(), cells = below.nodes.size();
+    auto isBoundary = [&](int v) { return below.node[v] != -1 && below.node[v] < below.boundaryCount[below.cell[v]]; };
+
+    //* cells are neighbours if an edge goes between them, only boundary vertices have such edges
+    vector<vector<int>> neighbours(cells);
+    for (int v = 0; v < n; v++) {
+        if (!isBoundary(v)) continue;
+        for (Edge<int>* e : vertices[v]->getAdj()) {
+            int a = below.cell[v], b = below.cell[e->getDest()->getIndex()];
+            if (a == b) continue;
+            neighbours[a].push_back(b);
+            neighbours[b].push_back(a);
+        }
+    }
+    for (vector<int>& adjacent : neighbours) {
+        sort(adjacent.begin(), adjacent.end());
+        adjacent.erase(unique(adjacent.begin(), adjacent.end()), adjacent.end());
+    }
+
+    //* grown breadth first from the lowest cell not in a group yet, as the regions of a GraphPartition, skipping the
+    //* cells that don't fit anymore
+    vector<int> group(cells, -1), grown;
+    vector<size_t> size(cells, 0);
+    for (int v = 0; v < n; v++) size[below.cell[v]]++;
+    int groups = 0;
+    for (int seed = 0; seed < cells; seed++) {
+        if (group[seed] != -1) continue;
+        grown.assign(1, seed);
+        group[seed] = groups;
+        size_t total = size[seed];
+        for (size_t head = 0; head < grown.size() && total < capacity; head++) {
+            for (int c : neighbours[grown[head]]) {
+                if (group[c] == -1 && total + size[c] <= capacity) {
+                    group[c] = groups;
+                    grown.push_back(c);
+                    total += size[c];
+                }
+            }
+        }
+        groups++;
+    }
+    //* a single cell holding the whole graph would never be searched
+    if (groups == cells || groups == 1) return false;
+
+    Level above;
+    above.cell.assign(n, -1);
+    above.node.assign(n, -1);
+    for (int v = 0; v < n; v++) above.cell[v] = group[below.cell[v]];
+    vector<vector<int>> inner(groups);
+    above.nodes.assign(groups, vector<int>());
+    for (int v = 0; v < n; v++) {
+        if (!isBoundary(v)) continue;
+        int c = above.cell[v];
+        bool boundary = false;
+        for (Edge<int>* e : vertices[v]->getAdj()) boundary |= above.cell[e->getDest()->getIndex()] != c;
+        for (Edge<int>* e : vertices[v]->getIncoming()) boundary |= above.cell[e->getOrig()->getIndex()] != c;
+        (boundary ? above.nodes[c] : inner[c]).push_back(v);
+    }
+    for (int c = 0; c < groups; c++) {
+        above.boundaryCount.push_back(above.nodes[c].size());
+        above.nodes[c].insert(above.nodes[c].end(), inner[c].begin(), inner[c].end());
+        for (size_t i = 0; i < above.nodes[c].size(); i++) above.node[above.nodes[c][i]] = i;
+    }
+    prepareCliques(above.cliqueFirst, above.clique, above.dirty, above.boundaryCount);
+    levels.push_back(above);
+    return true;
+}
+
+const double* MultiLevelOverlay::cliqueRow(int level, int c, int i) const {
+    const Level& l = levels[level - 1];
+    return l.clique.data() + l.cliqueFirst[c] + (size_t)i * l.boundaryCount[c];
+}
+
+void MultiLevelOverlay::searchCell(int level, int c, int source, int target, CellSearch& search) const {
+    const Level& l = levels[level - 1];
+    const vector<int>& nodes = l.nodes[c];
+    search.dist.assign(nodes.size(), INF);
+    search.parent.assign(nodes.size(), -1);
+    search.edge.assign(nodes.size(), nullptr);
+    typedef pair<double, int> Item;
+    priority_queue<Item, vector<Item>, greater<Item>> q;
+    search.dist[source] = 0;
+    q.push(Item(0, source));
+    while (!q.empty()) {
+        Item item = q.top();
+        q.pop();
+        int x = item.second;
+        if (item.first > search.dist[x]) continue; // outdated entry
+        if (x == target) break;
+        auto relax = [&](int y, double w, Edge<int>* e) {
+            if (search.dist[x] + w >= search.dist[y]) return;
+            search.dist[y] = search.dist[x] + w;
+            search.parent[y] = x;
+            search.edge[y] = e;
+            q.push(Item(search.dist[y], y));
+        };
+        int v = nodes[x];
+        if (level == 1) {
+            for (Edge<int>* e : vertices[v]->getAdj()) {
+                int u = e->getDest()->getIndex();
+                double w = weights->driveTime(e->getIndex());
+                if (w != INF && l.cell[u] == c) relax(l.node[u], w, e);
+            }
+            continue;
+        }
+        //* across its sub cell by the clique, and out of it by the edges to the other sub cells of c
+        const Level& sub = levels[level - 2];
+        int s = sub.cell[v], b = sub.boundaryCount[s], i = sub.node[v];
+        const double* row = cliqueRow(level - 1, s, i);
+        for (int j = 0; j < b; j++) {
+            if (j != i && row[j] != INF) relax(l.node[sub.nodes[s][j]], row[j], nullptr);
+        }
+        for (Edge<int>* e : vertices[v]->getAdj()) {
+            int u = e->getDest()->getIndex();
+            double w = weights->driveTime(e->getIndex());
+            if (w != INF && sub.cell[u] != s && l.cell[u] == c) relax(l.node[u], w, e);
+        }
+    }
+}
+
+void MultiLevelOverlay::customize(unsigned threads) {
+    if (!built) return;
+    weights = graph->getWeights();
+    //* changes markChanged wasn't told about may be anywhere
+    if (!customized || weights->getVersion() - customizedVersion != markedChanges) {
+        for (Level& l : levels) fill(l.dirty.begin(), l.dirty.end(), 1);
+    }
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    vector<CellSearch> searches(threads);
+
+    //* the cliques of a level only use the ones below, so every cell of a level can be done at once
+    for (size_t level = 1; level <= levels.size(); level++) {
+        Level& l = levels[level - 1];
+        vector<int> cells;
+        for (size_t c = 0; c < l.dirty.size(); c++) {
+            if (l.dirty[c]) cells.push_back(c);
+        }
+        parallelFor(cells.size(), threads, [&](size_t from, size_t to, unsigned t) {
+            for (size_t k = from; k < to; k++) {
+                int c = cells[k], b = l.boundaryCount[c];
+                double* clique = l.clique.data() + l.cliqueFirst[c];
+                for (int i = 0; i < b; i++) {
+                    searchCell(level, c, i, -1, searches[t]);
+                    copy(searches[t].dist.begin(), searches[t].dist.begin() + b, clique + (size_t)i * b);
+                }
+            }
+        }, 2); // a cell is a coarse work item
+        fill(l.dirty.begin(), l.dirty.end(), 0);
+    }
+    customizedVersion = weights->getVersion();
+    markedChanges = 0;
+    customized = true;
+}
+
+void MultiLevelOverlay::markChanged(Edge<int>* e) {
+    if (!built) return;
+    markedChanges++;
+    int u = e->getOrig()->getIndex(), w = e->getDest()->getIndex();
+    //* cells are nested, so once both ends share a cell they share every cell above it
+    for (Level& l : levels) {
+        if (l.cell[u] == l.cell[w]) l.dirty[l.cell[u]] = 1;
+    }
+}
+
+double MultiLevelOverlay::query(Vertex<int>* origin, Vertex<int>* dest, vector<int>& res, vector<Edge<int>*>* edges) {
+    res.clear();
+    if (edges) edges->clear();
+    if (!built || origin == nullptr || dest == nullptr) return -1;
+    weights = graph->getWeights();
+
+    for (int v : touched) {
+        dist[v] = INF;
+        parent[v] = -1;
+        parentEdge[v] = nullptr;
+        parentLevel[v] = 0;
+    }
+    touched.clear();
+
+    int s = origin->getIndex(), t = dest->getIndex();
+    //* highest level where the cell of v holds neither end, cells are nested so it is the amount of such levels
+    auto levelOf = [&](int v) {
+        int l = 0;
+        while (l < (int)levels.size() && levels[l].cell[v] != levels[l].cell[s] && levels[l].cell[v] != levels[l].cell[t]) l++;
+        return l;
+    };
+
+    typedef pair<double, int> Item;
+    priority_queue<Item, vector<Item>, greater<Item>> q;
+    dist[s] = 0;
+    touched.push_back(s);
+    q.push(Item(0, s));
+    uint64_t settled = 0, relaxed = 0;
+    QueryBudget* budget = QueryBudget::active();
+    while (!q.empty()) {
+        Item item = q.top();
+        q.pop();
+        int v = item.second;
+        if (item.first > dist[v]) continue; // outdated entry
+        if (budget != nullptr && !budget->settle()) break;
+        settled++;
+        if (v == t) break;
+
+        auto relax = [&](int u, double w, Edge<int>* e, int level) {
+            if (dist[v] + w >= dist[u]) return;
+            relaxed++;
+            if (dist[u] == INF) touched.push_back(u);
+            dist[u] = dist[v] + w;
+            parent[u] = v;
+            parentEdge[u] = e;
+            parentLevel[u] = level;
+            q.push(Item(dist[u], u));
+        };
+        int level = levelOf(v);
+        if (level == 0) {
+            for (Edge<int>* e : vertices[v]->getAdj()) {
+                double w = weights->driveTime(e->getIndex());
+                if (w != INF) relax(e->getDest()->getIndex(), w, e, 0);
+            }
+            continue;
+        }
+        //* v is reached through the boundary of its cell, which it crosses by the clique or leaves by an edge
+        const Level& l = levels[level - 1];
+        int c = l.cell[v], i = l.node[v], b = l.boundaryCount[c];
+        if (i != -1 && i < b) {
+            const double* row = cliqueRow(level, c, i);
+            for (int j = 0; j < b; j++) {
+                if (j != i && row[j] != INF) relax(l.nodes[c][j], row[j], nullptr, level);
+            }
+        }
+        for (Edge<int>* e : vertices[v]->getAdj()) {
+            int u = e->getDest()->getIndex();
+            double w = weights->driveTime(e->getIndex());
+            if (w != INF && l.cell[u] != c) relax(u, w, e, 0);
+        }
+    }
+    Metrics::add(Metrics::searches);
+    Metrics::add(Metrics::settledVertices, settled);
+    Metrics::add(Metrics::relaxedEdges, relaxed);
+    if (dist[t] == INF) return -1;
+
+    vector<int> steps;
+    for (int v = t; v != s; v = parent[v]) steps.push_back(v);
+    reverse(steps.begin(), steps.end());
+    vector<Edge<int>*> path;
+    int from = s;
+    for (int v : steps) {
+        if (parentEdge[v] != nullptr) path.push_back(parentEdge[v]);
+        else unpack(parentLevel[v], from, v, path);
+        from = v;
+    }
+
+    res.push_back(origin->getInfo());
+    for (Edge<int>* e : path) res.push_back(e->getDest()->getInfo());
+    if (edges) edges->swap(path);
+    return dist[t];
+}
+
+void MultiLevelOverlay::unpack(int level, int u, int w, vector<Edge<int>*>& path) {
+    const Level& l = levels[level - 1];
+    int c = l.cell[u];
+    searchCell(level, c, l.node[u], l.node[w], unpackSearch);
+    //* the steps are copied out first, unpacking the level below reuses the search
+    vector<pair<int, Edge<int>*>> steps;
+    for (int x = l.node[w]; x != l.node[u] && x != -1; x = unpackSearch.parent[x]) steps.push_back(make_pair(x, unpackSearch.edge[x]));
+    reverse(steps.begin(), steps.end());
+    int from = u;
+    for (const pair<int, Edge<int>*>& step : steps) {
+        int v = l.nodes[c][step.first];
+        if (step.second != nullptr) path.push_back(step.second);
+        else unpack(level - 1, from, v, path);
+        from = v;
+    }
+}
+
+bool MultiLevelOverlay::isBuilt() const {
+    return built;
+}
+
+bool MultiLevelOverlay::needsCustomization() const {
+    return !customized || customizedVersion != graph->getVersion();
+}
+
+int MultiLevelOverlay::getLevelCount() const {
+    return levels.size();
+}
+
+int MultiLevelOverlay::getCellCount(int level) const {
+    return levels[level - 1].nodes.size();
+}
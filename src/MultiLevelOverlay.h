@@ -0,0 +1,136 @@
+#ifndef MULTI_LEVEL_OVERLAY_H
+#define MULTI_LEVEL_OVERLAY_H
+
+#include <memory>
+#include <vector>
+#include <Graph.h>
+#include "GraphPartition.h"
+
+//* Most levels of cells a MultiLevelOverlay builds, fewer if grouping the cells of a level doesn't leave several cells
+#ifndef OVERLAY_LEVELS
+#define OVERLAY_LEVELS 3
+#endif
+
+//* How many times more vertices a cell may hold than the cells of the level below
+#ifndef OVERLAY_CELL_FANOUT
+#define OVERLAY_CELL_FANOUT 8
+#endif
+
+/**
+ * @brief Multi-level overlay (CRP style) of the driving times of a Graph<int>.
+ *
+ * Preprocessing is split in two phases:
+ * - build: metric independent. The cells of level 1 are the regions of a GraphPartition, and the cells of every level
+ *   above group neighbouring cells of the level below, up to OVERLAY_CELL_FANOUT times their size, so cells are nested. The boundary
+ *   vertices of a cell are the ones with an edge to or from another cell of the same level.
+ * - customize: for every cell, the shortest driving times between each pair of its boundary vertices (its clique),
+ *   using the original edges inside it on level 1 and the cliques of its sub cells with the edges between them above.
+ *   Levels go bottom up and the cells of a level are split between threads. After drive times change only the cells
+ *   holding both ends of a changed edge (and so the cells above them) are customized again.
+ *
+ * A query is a dijkstra that follows the original edges in the level 1 cells of the origin and the destination, and
+ * for any other vertex the cliques and the edges between cells of the highest level where its cell holds neither end.
+ * Cliques on the path are unpacked back to the original edges with searches inside their cells, so queries give the
+ * same vertex sequence format as getPath.
+ *
+ * Queries use internal buffers, so a single instance must not be queried by several threads at once.
+ */
+class MultiLevelOverlay
+{
+public:
+    /**
+     * @brief Partitions g into the nested cells of every level.
+     *
+     * O(L (|V| + |E|)) time complexity, where L is the amount of levels.
+     */
+    void build(Graph<int>* g, unsigned maxLevels = OVERLAY_LEVELS, unsigned cellSize = PARTITION_REGION_SIZE, unsigned fanout = OVERLAY_CELL_FANOUT);
+
+    /**
+     * @brief Computes the cliques of every cell marked by markChanged, or of every cell the first time and whenever
+     * drive times changed without markChanged being told.
+     *
+     * @param threads Amount of threads to use, 0 uses every hardware thread.
+     *
+     * O(C B (E_C + V_C) log V_C) time complexity, where C is the amount of cells customized, B their largest amount of
+     * boundary vertices and V_C and E_C the size of their search graphs, split between the threads level by level.
+     */
+    void customize(unsigned threads = 0);
+
+    /**
+     * @brief Marks the cells whose cliques may use e to be customized again. To be called when its drive time changes.
+     *
+     * O(L) time complexity.
+     */
+    void markChanged(Edge<int>* e);
+
+    /**
+     * @brief Shortest driving path from origin to dest with the customized cliques.
+     *
+     * @param origin Pointer to the origin vertex.
+     * @param dest Pointer to the destination vertex.
+     * @param res Filled with the ids of the vertices on the path, from origin to dest.
+     * @param edges If not nullptr, filled with the original edges of the path, in order.
+     * @return The total distance of the path, -1 if there is no path.
+     *
+     * O(S log S + U) time complexity, where S is the amount of vertices and clique entries the search reaches and U
+     * the cost of the searches unpacking the cliques on the path.
+     */
+    double query(Vertex<int>* origin, Vertex<int>* dest, std::vector<int>& res, std::vector<Edge<int>*>* edges = nullptr);
+
+    bool isBuilt() const;
+    //* True if customize was never called or the graph weights changed since
+    bool needsCustomization() const;
+    int getLevelCount() const;
+    int getCellCount(int level) const;
+
+private:
+    struct Level
+    {
+        std::vector<int> cell; //* by vertex index
+        //* vertices searched inside each cell, its boundary vertices first: every vertex of the cell on level 1, the
+        //* boundary vertices of the level below above
+        std::vector<std::vector<int>> nodes;
+        std::vector<int> node; //* position of each vertex in the nodes of its cell, -1 if not one of them
+        std::vector<int> boundaryCount;
+        std::vector<size_t> cliqueFirst; //* b x b driving times of each cell, row by row from the boundary vertex
+        std::vector<double> clique;
+        std::vector<char> dirty;
+    };
+
+    //* Dijkstra inside a single cell, by position in the nodes of the cell
+    struct CellSearch
+    {
+        std::vector<double> dist;
+        std::vector<int> parent;
+        std::vector<Edge<int>*> edge; //* the original edge from the parent, nullptr if a clique of the level below
+    };
+
+    Graph<int>* graph = nullptr;
+    bool built = false, customized = false;
+    unsigned long customizedVersion = 0;
+    unsigned long markedChanges = 0;
+    std::vector<Vertex<int>*> vertices;
+    std::vector<Level> levels; //* levels[l - 1] holds the cells of level l
+    //* weights snapshot pinned by the running customize or query, the original edges are read from it
+    std::shared_ptr<const EdgeWeights> weights;
+
+    //* query buffers
+    std::vector<double> dist;
+    std::vector<int> parent;
+    std::vector<Edge<int>*> parentEdge;
+    std::vector<int> parentLevel; //* level of the clique the vertex was reached by, 0 if an original edge
+    std::vector<int> touched;
+    CellSearch unpackSearch;
+
+    //* Groups the cells of the last level into cells of up to capacity vertices of a new level above, false if no two
+    //* cells could be grouped or all of them would be
+    bool addLevel(size_t capacity);
+    //* The clique row of the boundary vertex of a cell at position i
+    const double* cliqueRow(int level, int c, int i) const;
+    //* Searches the cell c of the given level from the node at position source, stopping once target is settled
+    void searchCell(int level, int c, int source, int target, CellSearch& search) const;
+    //* Appends the original edges of the clique entry from u to w of the given level
+    void unpack(int level, int u, int w, std::vector<Edge<int>*>& path);
+};
+
+#endif //MULTI_LEVEL_OVERLAY_H
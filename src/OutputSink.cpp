@@ -0,0 +1,17 @@
+#include "OutputSink.h"
+#include <cmath>
+#include <cstdio>
+
+OutputSink& OutputSink::operator<<(double d) {
+    //* Whole numbers under 10^6 (every time in the data set and their sums) are written by %g without a decimal
+    //* point or an exponent, exactly like an integer. Anything else, -0 included, takes the general path.
+    if (std::fabs(d) < 1e6 && d == std::floor(d) && !(d == 0 && std::signbit(d))) {
+        char digits[16];
+        char* end = digits + sizeof(digits);
+        char* begin = formatInteger((long long)d, end);
+        return write(begin, end - begin);
+    }
+    char general[32];
+    int length = std::snprintf(general, sizeof(general), "%g", d);
+    return write(general, length);
+}
@@ -0,0 +1,99 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+//* Bytes an OutputSink over a stream holds before writing them out on its own
+#ifndef OUTPUT_SINK_BUFFER
+#define OUTPUT_SINK_BUFFER (64 * 1024)
+#endif
+
+/**
+ * @brief Buffered text output, used for every query result in place of an ostream with std::endl.
+ *
+ * A sink either appends to a string (results that are cached or kept in order before being written) or buffers
+ * for a stream, which only gets written when the buffer fills up, on flush and when the sink is destroyed, so
+ * flushes happen at query boundaries and not at every line.
+ *
+ * Numbers are formatted by hand and come out exactly as an ostream with the default flags would write them:
+ * integers in decimal and doubles as %g with 6 significant digits.
+ */
+class OutputSink
+{
+public:
+    //* Appends everything to text
+    explicit OutputSink(std::string& text) : text(&text) {}
+
+    //* Buffers everything for stream
+    explicit OutputSink(std::ostream& stream) : text(&buffer), stream(&stream) {
+        buffer.reserve(OUTPUT_SINK_BUFFER);
+    }
+
+    ~OutputSink() { flush(); }
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    OutputSink& operator<<(char c) {
+        text->push_back(c);
+        return spill();
+    }
+
+    OutputSink& operator<<(const char* s) { return write(s, std::strlen(s)); }
+    OutputSink& operator<<(const std::string& s) { return write(s.data(), s.size()); }
+
+    OutputSink& operator<<(int n) {
+        char digits[16];
+        char* end = digits + sizeof(digits);
+        char* begin = formatInteger(n, end);
+        return write(begin, end - begin);
+    }
+
+    OutputSink& operator<<(double d);
+
+    OutputSink& write(const char* s, size_t n) {
+        text->append(s, n);
+        return spill();
+    }
+
+    /**
+     * @brief Writes what is buffered to the stream and flushes it. Does nothing when appending to a string.
+     */
+    void flush() {
+        if (stream == nullptr) return;
+        if (!buffer.empty()) stream->write(buffer.data(), buffer.size());
+        buffer.clear();
+        stream->flush();
+    }
+
+    /**
+     * @brief Writes the decimal digits of n so that they end right before end.
+     * @return Where the digits start.
+     */
+    static char* formatInteger(long long n, char* end) {
+        unsigned long long magnitude = n < 0 ? 0ULL - (unsigned long long)n : (unsigned long long)n;
+        do {
+            *--end = '0' + magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude != 0);
+        if (n < 0) *--end = '-';
+        return end;
+    }
+
+private:
+    std::string* text;
+    std::string buffer;
+    std::ostream* stream = nullptr;
+
+    OutputSink& spill() {
+        if (stream != nullptr && buffer.size() >= OUTPUT_SINK_BUFFER) {
+            stream->write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+        return *this;
+    }
+};
+
+#endif //OUTPUT_SINK_H
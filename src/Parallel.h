@@ -0,0 +1,36 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+//* Below this amount of work items a parallel section just runs on the calling thread
+#ifndef PARALLEL_GRAIN
+#define PARALLEL_GRAIN 1024
+#endif
+
+/**
+ * @brief Splits [0, n) in one contiguous range per thread and calls f(begin, end, thread) on each, waiting for all of them.
+ *
+ * @param n Amount of work items.
+ * @param threads Amount of threads to use, 0 uses every hardware thread.
+ * @param f Callable taking (size_t begin, size_t end, unsigned thread).
+ * @param grain Below this amount of work items everything runs on the calling thread, lower it for coarse items.
+ */
+template <class F>
+inline void parallelFor(size_t n, unsigned threads, F f, size_t grain = PARALLEL_GRAIN) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads <= 1 || n < grain) {
+        f(0, n, 0);
+        return;
+    }
+    std::vector<std::thread> pool;
+    size_t chunk = (n + threads - 1) / threads;
+    for (unsigned t = 0; t < threads && t * chunk < n; t++) {
+        pool.emplace_back(f, t * chunk, std::min(n, (t + 1) * chunk), t);
+    }
+    for (std::thread& th : pool) th.join();
+}
+
+#endif //PARALLEL_H
@@ -0,0 +1,121 @@
+#include "ParetoSearch.h"
+#include "Metrics.h"
+#include "QueryBudget.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <tuple>
+using namespace std;
+
+//* a is at least as good as b in both times
+static bool dominates(double drive, double walk, double otherDrive, double otherWalk) {
+    return drive <= otherDrive && walk <= otherWalk;
+}
+
+bool ParetoSearch::insert(const Label& label, int destination) {
+    //* a label no better than a route already found can't lead to a better one, times only grow
+    for (int i : sets[2 * destination + 1]) {
+        if (dominates(labels[i].drive, labels[i].walk, label.drive, label.walk)) return false;
+    }
+    vector<int>& set = sets[2 * label.vertex + label.walking];
+    for (int i : set) {
+        if (dominates(labels[i].drive, labels[i].walk, label.drive, label.walk)) return false;
+    }
+    size_t kept = 0;
+    for (int i : set) {
+        if (dominates(label.drive, label.walk, labels[i].drive, labels[i].walk)) labels[i].dominated = true;
+        else set[kept++] = i;
+    }
+    set.resize(kept);
+    if (set.size() >= PARETO_MAX_LABELS) return false;
+    if (set.empty()) touched.push_back(2 * label.vertex + label.walking);
+    set.push_back(labels.size());
+    labels.push_back(label);
+    return true;
+}
+
+void ParetoSearch::phasePath(int label, vector<int>& res, const vector<Vertex<int>*>& vertices) const {
+    res.clear();
+    bool walking = labels[label].walking;
+    for (int l = label; l != -1 && labels[l].walking == walking; l = labels[l].parent) {
+        res.push_back(vertices[labels[l].vertex]->getInfo());
+    }
+    reverse(res.begin(), res.end());
+}
+
+void ParetoSearch::query(Graph<int>* g, Vertex<int>* origin, Vertex<int>* dest, const RestrictionMask* mask, const ParkingOccupancy& occupancy, vector<Option>& options) {
+    options.clear();
+    if (origin == nullptr || dest == nullptr) return;
+    //* dijkstra never expands a restricted origin
+    if (mask != nullptr && mask->stopsAt(origin->getIndex())) return;
+
+    //* labels refer to vertices by their position in the adjacency arrays
+    adjacency.refresh(g);
+    const vector<Vertex<int>*>& vertices = adjacency.vertices();
+    const int* targets = adjacency.targets();
+    const double* driveTimes = adjacency.driveTimes();
+    const double* walkTimes = adjacency.walkTimes();
+    if (sets.size() != 2 * vertices.size()) {
+        sets.assign(2 * vertices.size(), {});
+        touched.clear();
+    }
+    for (int set : touched) sets[set].clear();
+    touched.clear();
+    labels.clear();
+
+    int s = adjacency.position(origin->getIndex()), t = adjacency.position(dest->getIndex());
+    //* by total time and then drive time, the label numbers break the remaining ties so the result is deterministic
+    typedef tuple<double, double, int> Item;
+    priority_queue<Item, vector<Item>, greater<Item>> q;
+    insert({ 0, 0, s, false, false, -1 }, t);
+    q.push(Item(0, 0, 0));
+
+    uint64_t settled = 0, relaxed = 0;
+    QueryBudget* budget = QueryBudget::active();
+    auto extend = [&](const Label& next) {
+        if (!insert(next, t)) return;
+        relaxed++;
+        q.push(Item(next.drive + next.walk, next.drive, labels.size() - 1));
+    };
+    while (!q.empty()) {
+        int l = get<2>(q.top());
+        q.pop();
+        if (labels[l].dominated) continue;
+        Label label = labels[l]; // labels may grow while it is extended
+        if (label.walking && label.vertex == t) continue;
+        Vertex<int>* v = vertices[label.vertex];
+        if (mask != nullptr && mask->stopsAt(v->getIndex())) continue;
+        if (budget != nullptr && !budget->settle()) break;
+        settled++;
+
+        //* leave the car, neither at the origin nor at the destination, as in the eco mode
+        if (!label.walking && occupancy.isAvailable(v) && label.vertex != s && label.vertex != t) {
+            extend({ label.drive, label.walk, label.vertex, true, false, l });
+        }
+        const double* weights = label.walking ? walkTimes : driveTimes;
+        for (int i = adjacency.firstEdge(label.vertex); i < adjacency.endEdge(label.vertex); i++) {
+            if (weights[i] == INF) continue;
+            if (mask != nullptr && mask->excludes(adjacency.edge(i)->getIndex(), vertices[targets[i]]->getIndex())) continue;
+            if (label.walking) extend({ label.drive, label.walk + weights[i], targets[i], true, false, l });
+            else extend({ label.drive + weights[i], label.walk, targets[i], false, false, l });
+        }
+    }
+    Metrics::add(Metrics::searches);
+    Metrics::add(Metrics::settledVertices, settled);
+    Metrics::add(Metrics::relaxedEdges, relaxed);
+
+    vector<int> frontier = sets[2 * t + 1];
+    sort(frontier.begin(), frontier.end(), [this](int a, int b) { return labels[a].drive < labels[b].drive; });
+    for (int l : frontier) {
+        options.emplace_back();
+        Option& option = options.back();
+        option.driveTime = labels[l].drive;
+        option.walkTime = labels[l].walk;
+        phasePath(l, option.walkPath, vertices);
+        //* the first walking label is where the car was left, its parent the driving label of the same vertex
+        int park = l;
+        while (labels[labels[park].parent].walking) park = labels[park].parent;
+        option.parking = vertices[labels[park].vertex];
+        phasePath(labels[park].parent, option.drivePath, vertices);
+    }
+}
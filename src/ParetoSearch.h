@@ -0,0 +1,82 @@
+#ifndef PARETO_SEARCH_H
+#define PARETO_SEARCH_H
+
+#include <vector>
+#include <Graph.h>
+#include "ShortestPathAlgorithms.h"
+#include "ParkingOccupancy.h"
+
+//* Most labels kept on a vertex for each phase (driving or walking), labels beyond it are dropped
+#ifndef PARETO_MAX_LABELS
+#define PARETO_MAX_LABELS 64
+#endif
+
+/**
+ * @brief Every route that is best for some trade off between driving and walking: drive from an origin to a parking
+ * vertex, leave the car there and walk to a destination.
+ *
+ * A multi-criteria label setting search over two copies of the graph, one where edges cost their drive time and one
+ * where they cost their walk time, joined at the parking vertices. Each label is a (drive, walk) pair for a vertex
+ * and phase, and labels are settled in order of their total time. A label is dropped when another one of the same
+ * vertex and phase, or one already at the destination, is at least as good in both times (dominance), so every
+ * vertex ends up with its Pareto set and the destination with the frontier.
+ *
+ * Each vertex keeps at most PARETO_MAX_LABELS labels per phase. Labels are found cheapest first, so a full set keeps
+ * the routes with the least total time and only very long frontiers are cut.
+ *
+ * Parking vertices follow the rules of the eco mode: only available car parks, neither at the origin nor at the
+ * destination, and restrictions follow the same rules as dijkstra with a RestrictionMask, in both phases.
+ *
+ * Labels are kept in internal buffers, so a single instance must not be queried by several threads at once.
+ */
+class ParetoSearch
+{
+public:
+    /**
+     * @brief A route of the frontier.
+     */
+    struct Option
+    {
+        double driveTime;
+        double walkTime;
+        Vertex<int>* parking;
+        std::vector<int> drivePath; //* ids from the origin to the parking
+        std::vector<int> walkPath;  //* ids from the parking to the destination
+    };
+
+    /**
+     * @brief Pareto frontier of the (drive time, walk time) routes from origin to dest through a parking vertex.
+     *
+     * @param mask Restrictions of both phases, nullptr if none.
+     * @param occupancy Tells which car parks have free spaces.
+     * @param options Filled with the routes of the frontier, by increasing drive time (so decreasing walk time),
+     * empty if no parking vertex can be driven to and walked from.
+     *
+     * O(L log L + L d P) time complexity, where L is the amount of labels created, d the largest degree and P PARETO_MAX_LABELS.
+     */
+    void query(Graph<int>* g, Vertex<int>* origin, Vertex<int>* dest, const RestrictionMask* mask, const ParkingOccupancy& occupancy, std::vector<Option>& options);
+
+private:
+    struct Label
+    {
+        double drive;
+        double walk;
+        int vertex; //* position in the adjacency arrays
+        bool walking;
+        bool dominated; //* removed from its set by a better label, left in the queue
+        int parent;     //* label it was extended from, -1 for the first one
+    };
+
+    CompactAdjacency<int> adjacency;
+    std::vector<Label> labels;
+    //* labels of every vertex and phase, at 2 * position + walking
+    std::vector<std::vector<int>> sets;
+    std::vector<int> touched;
+
+    //* Adds the label to its set unless something in the set or at the destination is at least as good
+    bool insert(const Label& label, int destination);
+    //* Vertices of the path of a label from the first label of its phase, in order
+    void phasePath(int label, std::vector<int>& res, const std::vector<Vertex<int>*>& vertices) const;
+};
+
+#endif //PARETO_SEARCH_H
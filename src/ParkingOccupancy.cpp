@@ -0,0 +1,81 @@
+#include "ParkingOccupancy.h"
+#include "ParseFile.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+void ParkingOccupancy::attach(Graph<int>* g) {
+    vector<Vertex<int>*> vertexSet = g->getVertexSet();
+    count = vertexSet.size();
+    occupied.reset(new atomic<int>[count]);
+    parking.clear();
+    codes.clear();
+    for (Vertex<int>* v : vertexSet) {
+        occupied[v->getIndex()].store(0, memory_order_relaxed);
+        if (v->getParking() <= 0) continue;
+        parking.push_back(v);
+        codes.emplace(v->getCode(), v->getIndex());
+    }
+    version.fetch_add(1, memory_order_release);
+}
+
+void ParkingOccupancy::setOccupied(int index, int spaces) {
+    if ((size_t)index >= count) return;
+    if (occupied[index].exchange(spaces, memory_order_acq_rel) != spaces) {
+        version.fetch_add(1, memory_order_release);
+    }
+}
+
+int ParkingOccupancy::load(const string& filename) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error occurred when opening Occupancy file" << endl;
+        return 1;
+    }
+    string line;
+    getline(file, line); // first line is ignored, header
+    while (getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        istringstream iss(line);
+        string code, spaces;
+        getline(iss, code, ',');
+        getline(iss, spaces);
+        auto v = codes.find(code);
+        if (v == codes.end()) {
+            cerr << "Not a parking location: " << code << endl;
+            return 1;
+        }
+        int spacesInt = parseInt(spaces);
+        if (spacesInt < 0) {
+            cerr << "Invalid occupied spaces: " << spaces << endl;
+            return 1;
+        }
+        setOccupied(v->second, spacesInt);
+    }
+    return 0;
+}
+
+OccupancyFeed::OccupancyFeed(ParkingOccupancy& occupancy, const string& filename, unsigned seconds) : occupancy(occupancy), filename(filename), interval(seconds) {
+    occupancy.load(filename);
+    worker = thread(&OccupancyFeed::run, this);
+}
+
+OccupancyFeed::~OccupancyFeed() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void OccupancyFeed::run() {
+    unique_lock<mutex> lock(mtx);
+    while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+        lock.unlock();
+        occupancy.load(filename);
+        lock.lock();
+    }
+}
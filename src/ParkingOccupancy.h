@@ -0,0 +1,107 @@
+#ifndef PARKING_OCCUPANCY_H
+#define PARKING_OCCUPANCY_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <Graph.h>
+
+//* Default seconds between two reads of an occupancy feed
+#ifndef OCCUPANCY_FEED_INTERVAL
+#define OCCUPANCY_FEED_INTERVAL 5
+#endif
+
+/**
+ * @brief Live occupancy of the car parks of a graph, along with the index of its parking vertices.
+ *
+ * The parking value of a vertex (last column of Locations.csv) is the capacity of its car park, 0 if it has none.
+ * A car park is available while fewer of its spaces are occupied than it has, and with no occupancy data every
+ * car park is empty.
+ *
+ * Occupied spaces are one atomic per vertex, so a feed can change them from another thread while queries read them,
+ * without locks: a read sees the last value written for that car park. Every change also bumps a version, results
+ * that depend on occupancy are cached with the version they were computed at.
+ */
+class ParkingOccupancy
+{
+public:
+    /**
+     * @brief Sizes the table for a graph, with every car park empty, and indexes its parking vertices.
+     * Not thread safe, it must be called before any query or feed uses the table.
+     *
+     * O(|V|) time complexity.
+     */
+    void attach(Graph<int>* g);
+
+    //* Vertices with a car park, in the order of the graph
+    const std::vector<Vertex<int>*>& parkingVertices() const { return parking; }
+
+    //* Whether v has a car park with free spaces
+    bool isAvailable(const Vertex<int>* v) const {
+        return v->getParking() > 0 && getOccupied(v->getIndex()) < v->getParking();
+    }
+
+    int getOccupied(int index) const {
+        return (size_t)index < count ? occupied[index].load(std::memory_order_acquire) : 0;
+    }
+
+    /**
+     * @brief Sets the occupied spaces of the car park of the vertex at index, lock free, from any thread.
+     * The version only changes if the value does.
+     */
+    void setOccupied(int index, int spaces);
+
+    uint64_t getVersion() const { return version.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Applies an occupancy file: after a header, rows `<code>,<occupied spaces>` for some of the car parks.
+     * Safe to call while queries run, every row is a separate setOccupied.
+     *
+     * @return 0 on success, 1 if the file could not be opened or a row names a vertex without a car park or has an
+     * invalid amount, in which case the rows before it are still applied.
+     *
+     * O(R) time complexity, where R is the amount of rows.
+     */
+    int load(const std::string& filename);
+
+private:
+    std::vector<Vertex<int>*> parking;
+    std::unordered_map<std::string, int> codes; //* index of every parking vertex by its code
+    std::unique_ptr<std::atomic<int>[]> occupied;
+    size_t count = 0;
+    std::atomic<uint64_t> version{0};
+};
+
+/**
+ * @brief Applies an occupancy file periodically from a background thread, for as long as it lives,
+ * so a feed that rewrites the file is followed while queries are answered.
+ */
+class OccupancyFeed
+{
+public:
+    OccupancyFeed(ParkingOccupancy& occupancy, const std::string& filename, unsigned seconds = OCCUPANCY_FEED_INTERVAL);
+    ~OccupancyFeed();
+
+    OccupancyFeed(const OccupancyFeed&) = delete;
+    OccupancyFeed& operator=(const OccupancyFeed&) = delete;
+
+private:
+    ParkingOccupancy& occupancy;
+    std::string filename;
+    std::chrono::seconds interval;
+    bool stopping = false;
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::thread worker;
+
+    void run();
+};
+
+#endif //PARKING_OCCUPANCY_H
@@ -1,18 +1,32 @@
 #include "ParseFile.h"
 #include "CLInterface.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Metrics.h"
+#include "RegionStore.h"
+#include <csignal>
+#include <cstring>
+#include <unordered_map>
 using namespace std;
 
+//* Distances.csv is parsed in pieces of about this many bytes, spread between every hardware thread
+#ifndef DISTANCE_CHUNK_BYTES
+#define DISTANCE_CHUNK_BYTES (1 << 20)
+#endif
+
 vector<Vertex<int>*> nAvoid = {};
 vector<Edge<int>*> eAvoid = {};
-Vertex<int>* must;
+vector<Vertex<int>*> waypoints = {};
+bool anyOrder = false;
 
 /* Auxiliary Methods*/
 bool parseArgument(string& line, string& argument, string& value);
 bool parseAvoidVertex(string& value, Graph<int>* g, vector<Vertex<int>*>& nAvoid);
 bool parseAvoidEdge(string& value, Graph<int>* g, vector<Edge<int>*>& eAvoid);
+bool parseUpdate(string& value, Graph<int>* g, Edge<int>*& e, double& driveTime, double& walkTime);
 /* Error Methods */
-void printParseError(ofstream& out, string& value, const string& actual);
-void printLineError(ofstream& out, string line);
+void printParseError(OutputSink& out, string& value, const string& actual);
+void printLineError(OutputSink& out, string line);
 
 int Parsefile::parseLocation(const string& filename, Graph<int>* graph) {
     fstream file(filename);
@@ -46,37 +60,202 @@ int Parsefile::parseLocation(const string& filename, Graph<int>* graph) {
     return 0;
 }
 
+namespace {
+    //* A row of the distances file, with its vertices already found
+    struct DistanceRow
+    {
+        Vertex<int>* v1;
+        Vertex<int>* v2;
+        double walkTime, driveTime;
+    };
+
+    //* A newline aligned piece of the distances file, parsed by a single thread
+    struct DistanceChunk
+    {
+        const char* begin;
+        const char* end;
+        std::vector<DistanceRow> rows;
+        std::string error; //* message of the first invalid row, rows after it are not parsed
+    };
+}
+
+//* Same result as parseInt on the same characters, without building a string for the common case of plain digits
+static int parseIntField(const char* begin, const char* end) {
+    if (begin != end && end - begin <= 9 && all_of(begin, end, [](char c) { return c >= '0' && c <= '9'; })) {
+        int value = 0;
+        for (const char* c = begin; c != end; c++) value = value * 10 + (*c - '0');
+        return value;
+    }
+    string value(begin, end);
+    return parseInt(value);
+}
+
+//* Splits the rows of a chunk the same way getline does: 3 comma separated fields and the walk time up to the '\r'
+static void parseDistanceChunk(DistanceChunk& chunk, const unordered_map<string, Vertex<int>*>& codes) {
+    const char* line = chunk.begin;
+    while (line < chunk.end) {
+        const char* lineEnd = static_cast<const char*>(memchr(line, '\n', chunk.end - line));
+        if (lineEnd == nullptr) lineEnd = chunk.end;
+        const char* p = line;
+        auto field = [&](char delimiter, const char*& begin, const char*& end) {
+            begin = p;
+            end = find(p, lineEnd, delimiter);
+            p = (end == lineEnd) ? lineEnd : end + 1;
+        };
+        const char *code1, *code1End, *code2, *code2End, *drive, *driveEnd, *walk, *walkEnd;
+        field(',', code1, code1End);
+        field(',', code2, code2End);
+        field(',', drive, driveEnd);
+        field('\r', walk, walkEnd);
+
+        double dt;
+        if (driveEnd - drive == 1 && *drive == 'X') dt = INF;
+        else dt = parseIntField(drive, driveEnd);
+        if (dt == -1) {
+            chunk.error = "Invalid drive time: " + string(drive, driveEnd);
+            return;
+        }
+        double walkTimeInt = parseIntField(walk, walkEnd);
+        if (walkTimeInt == -1) {
+            chunk.error = "Invalid walk time: " + string(walk, walkEnd);
+            return;
+        }
+        //* rows with unknown codes are skipped, as addBidirectionalEdge does
+        auto v1 = codes.find(string(code1, code1End)), v2 = codes.find(string(code2, code2End));
+        if (v1 != codes.end() && v2 != codes.end()) {
+            chunk.rows.push_back({ v1->second, v2->second, walkTimeInt, dt });
+        }
+        line = lineEnd + 1;
+    }
+}
+
 int Parsefile::parseDistance(const string& filename, Graph<int>* graph) {
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        cerr << "Error occurred when opening Distances file" << endl;
+        return 1;
+    }
+    const char* data = file.data();
+    const char* end = data + file.size();
+    const char* start = static_cast<const char*>(memchr(data, '\n', file.size())); // first line is ignored, header
+    if (start == nullptr) return 0;
+    start++;
+
+    //* Vertices are looked up by code in a hash map instead of a scan of the vertex set for every row
+    unordered_map<string, Vertex<int>*> codes;
+    vector<Vertex<int>*> vertexSet = graph->getVertexSet();
+    for (Vertex<int>* v : vertexSet) {
+        codes.emplace(v->getCode(), v); // the first vertex with a code wins, like findVertex
+    }
+
+    //* Chunks start right after a newline, so no row is split between two of them
+    size_t count = max<size_t>(1, (end - start) / DISTANCE_CHUNK_BYTES);
+    vector<DistanceChunk> chunks(count);
+    const char* at = start;
+    for (size_t i = 0; i < count; i++) {
+        chunks[i].begin = at;
+        if (i + 1 == count) {
+            at = end;
+        }
+        else {
+            at = max(at, start + (end - start) * (i + 1) / count);
+            const char* newline = static_cast<const char*>(memchr(at, '\n', end - at));
+            at = (newline == nullptr) ? end : newline + 1;
+        }
+        chunks[i].end = at;
+    }
+    parallelFor(count, 0, [&](size_t begin, size_t last, unsigned) {
+        for (size_t i = begin; i < last; i++) parseDistanceChunk(chunks[i], codes);
+    }, 1);
+
+    //* Rows up to the first invalid one are added in file order, so the graph is the same as a sequential load.
+    //* Every adjacency list is sized first with a counting pass so filling them never reallocates.
+    size_t valid = 0;
+    while (valid < count && chunks[valid].error.empty()) valid++;
+    size_t used = min(valid + 1, count);
+    vector<size_t> degree(vertexSet.size(), 0);
+    for (size_t i = 0; i < used; i++) {
+        for (const DistanceRow& row : chunks[i].rows) {
+            degree[row.v1->getIndex()]++;
+            degree[row.v2->getIndex()]++;
+        }
+    }
+    for (Vertex<int>* v : vertexSet) {
+        v->reserveEdges(degree[v->getIndex()], degree[v->getIndex()]);
+    }
+    for (size_t i = 0; i < used; i++) {
+        for (const DistanceRow& row : chunks[i].rows) {
+            graph->addBidirectionalEdge(row.v1, row.v2, row.walkTime, row.driveTime);
+        }
+        if (!chunks[i].error.empty()) {
+            cerr << chunks[i].error << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int Parsefile::parseProfiles(const string& filename, Graph<int>* graph, TravelTimeProfiles<int>& profiles) {
+    profiles.clear();
     fstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error occurred when opening Profiles file" << endl;
+        return 1;
+    }
     string line;
     getline(file, line); // first line is ignored, header
 
-    if (!file.is_open()) {
-        cerr << "Error occurred when opening Distances file" << endl;
-        return 1;
+    unordered_map<string, Vertex<int>*> codes;
+    for (Vertex<int>* v : graph->getVertexSet()) {
+        codes.emplace(v->getCode(), v);
     }
+    //* breakpoints of every segment, in the order their first row appears
+    vector<pair<Edge<int>*, vector<TravelTimeProfiles<int>::Breakpoint>>> segments;
+    unordered_map<Edge<int>*, size_t> positions;
     while (getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
         istringstream iss(line);
-        string code1, code2, walkTime, driveTime;
+        string code1, code2, departure, drive;
         getline(iss, code1, ',');
         getline(iss, code2, ',');
-        getline(iss, driveTime, ',');
-        getline(iss, walkTime, '\r');
-        double dt;
-        if (driveTime == "X") dt = INF;
-        else dt = parseInt(driveTime);
-        if (dt == -1) {
-            cerr << "Invalid drive time: " << driveTime << endl;
+        getline(iss, departure, ',');
+        getline(iss, drive);
+        auto v1 = codes.find(code1), v2 = codes.find(code2);
+        Edge<int>* e = nullptr;
+        if (v1 != codes.end() && v2 != codes.end()) {
+            for (Edge<int>* s : v1->second->getAdj()) {
+                if (s->getDest() == v2->second) {
+                    e = s;
+                    break;
+                }
+            }
+        }
+        if (e == nullptr || e->getDriveTime() == INF) {
+            cerr << "Invalid segment: " << code1 << "," << code2 << endl;
             return 1;
         }
-        double walkTimeInt = parseInt(walkTime);
-        if (walkTimeInt == -1) {
-            cerr << "Invalid walk time: " << walkTime << endl;
+        int departureInt = parseInt(departure);
+        if (departureInt < 0 || departureInt >= PROFILE_PERIOD) {
+            cerr << "Invalid departure: " << departure << endl;
+            return 1;
+        }
+        int driveInt = parseInt(drive);
+        if (driveInt == -1) {
+            cerr << "Invalid drive time: " << drive << endl;
+            return 1;
+        }
+        auto position = positions.emplace(e, segments.size());
+        if (position.second) segments.push_back({ e, {} });
+        segments[position.first->second].second.push_back({ (float)departureInt, (float)driveInt });
+    }
+    for (auto& segment : segments) {
+        sort(segment.second.begin(), segment.second.end());
+        if (!profiles.add(segment.first, segment.second)) {
+            cerr << "Invalid profile, repeated departures or not FIFO: " << segment.first->getOrig()->getCode() << "," << segment.first->getDest()->getCode() << endl;
             return 1;
         }
-        graph->addBidirectionalEdge(code1, code2, walkTimeInt, dt);
     }
-    file.close();
     return 0;
 }
 
@@ -126,13 +305,15 @@ bool parseArgument(string& line, string& argument, string& value) {
     return true;
 }
 
-void printLineError(ofstream& out, string line) {
-    out << "Invalid line" << endl << "-> " << line << endl << "Was empty" << endl;
-    out << endl;
+void printLineError(OutputSink& out, string line) {
+    Metrics::add(Metrics::parseErrors);
+    out << "Invalid line" << '\n' << "-> " << line << '\n' << "Was empty" << '\n';
+    out << '\n';
 }
 
-void printParseError(ofstream& out, string& value, const string& actual) {
-    out << "Invalid Argument/Value" << endl << "Was: " << value << endl << "Should be: " << actual << endl;
+void printParseError(OutputSink& out, string& value, const string& actual) {
+    Metrics::add(Metrics::parseErrors);
+    out << "Invalid Argument/Value" << '\n' << "Was: " << value << '\n' << "Should be: " << actual << '\n';
 }
 
 bool parseAvoidVertex(string& value, Graph<int>* g, vector<Vertex<int>*>& nAvoid) {
@@ -181,27 +362,76 @@ bool parseAvoidEdge(string& value, Graph<int>* g, vector<Edge<int>*>& eAvoid) {
     return true;
 }
 
+bool parseUpdate(string& value, Graph<int>* g, Edge<int>*& e, double& driveTime, double& walkTime) {
+    istringstream ss(value);
+    string segment, drive, walk;
+    if (ss.get() != '(') return false;
+    getline(ss, segment, ')');
+    if (ss.get() != ',') return false;
+    getline(ss, drive, ',');
+    getline(ss, walk);
+    e = parseEdge(segment, g);
+    if (e == nullptr) return false;
+    if (drive == "X") driveTime = INF;
+    else driveTime = parseInt(drive);
+    walkTime = parseInt(walk);
+    return driveTime != -1 && walkTime != -1;
+}
+
+//* A SIGINT cancels the queries of the batch being answered, and a second one ends the program as usual
+static void cancelBatch(int) {
+    CLInterface::getCancellation().cancel();
+    signal(SIGINT, SIG_DFL);
+}
+
+/**
+ * @brief Cancels the queries being answered on SIGINT while it lives, then puts back the previous handler and
+ * resets the token for the next batch.
+ */
+class BatchInterrupt
+{
+public:
+    BatchInterrupt() : previous(signal(SIGINT, cancelBatch)) {}
+    ~BatchInterrupt() {
+        if (previous != SIG_ERR) signal(SIGINT, previous);
+        CLInterface::getCancellation().reset();
+    }
+    bool isCancelled() const { return CLInterface::getCancellation().isCancelled(); }
+
+private:
+    void (*previous)(int);
+};
+
 int Parsefile::parseInput(const string& inputFileName, const string& outputFileName, Graph<int>* g) {
+    if (format == Output::textResults && BinaryBatch::hasMagic(inputFileName, BinaryBatch::requestMagic)) {
+        return parseBinaryInput(inputFileName, outputFileName, g);
+    }
     fstream input(inputFileName);
-    ofstream output(outputFileName);
+    ofstream file(outputFileName, format == Output::binaryRequests ? ios::out | ios::binary : ios::out);
+    //* everything is written here first and moved to the file by answerQueries, in order, along with the query results
+    string text;
+    OutputSink output(text);
     string line;
     string argument, value;
-    CLInterface interface;
     if (!input.is_open()) {
-        cerr << "Error occurred when opening Input file" << endl;
+        cerr << "Error occurred when opening Input file" << '\n';
         return 1;
     }
 
     bool err = false;
+    string name;
 
-    while (getline(input, line)) {
+    BatchInterrupt interrupt;
+    while (!interrupt.isCancelled() && getline(input, line)) {
         //* Ignore all empty lines between tests, reset state of error from previous test if needed
         if (line.empty()) {
             err = false;
             nAvoid.clear();
             eAvoid.clear();
-            must = nullptr;
-            output << endl;
+            waypoints.clear();
+            anyOrder = false;
+            output << '\n';
+            if (pending.size() >= BATCH_WINDOW) answerQueries(text, file, g);
             continue;
         }
 
@@ -211,13 +441,57 @@ int Parsefile::parseInput(const string& inputFileName, const string& outputFileN
         //* First look for Query name, queries should begin with a # and are marked as finished by an empty line
         
         if (line[0] == '#') {
-            output << line << endl;
+            name = line.substr(1);
+            output << line << '\n';
             //getline(input, line);
         }
+        else if (line.compare(0, 7, "Update:") == 0) {
+            Edge<int>* e;
+            double driveTime, walkTime;
+            if (!parseArgument(line, argument, value) || !parseUpdate(value, g, e, driveTime, walkTime)) {
+                err = true;
+                printParseError(output, line, "Update:(<id>/<code>,<id>/<code>),<drive>/X,<walk>");
+                continue;
+            }
+            if (format == Output::binaryRequests) {
+                BinaryBatch::appendUpdate(requests, e, driveTime, walkTime);
+                requestCount++;
+                continue;
+            }
+            //* queries read so far must see the old times, so they are answered before the change
+            answerQueries(text, file, g);
+            CLInterface interface;
+            interface.updateEdge(e, walkTime, driveTime, g);
+            output << line << '\n';
+            continue;
+        }
+        else if (line.compare(0, 7, "Engine:") == 0) {
+            CLInterface::Engine engine;
+            parseArgument(line, argument, value);
+            if (value == "dijkstra") engine = CLInterface::Engine::plainDijkstra;
+            else if (value == "cch") engine = CLInterface::Engine::customizableCH;
+            else if (value == "crp") engine = CLInterface::Engine::multiLevelOverlay;
+            else {
+                err = true;
+                printParseError(output, value, "Engine:<dijkstra>/<cch>/<crp>");
+                continue;
+            }
+            if (format == Output::binaryRequests) {
+                BinaryBatch::appendEngine(requests, engine);
+                requestCount++;
+                continue;
+            }
+            answerQueries(text, file, g);
+            CLInterface interface;
+            interface.setEngine(engine, g);
+            output << line << '\n';
+            continue;
+        }
         else {
             err = true;
-            output << "Unexpected Input in begining or end of Query" << endl
-            << "All queries should begin with '#' followed by the test name" << endl;
+            Metrics::add(Metrics::parseErrors);
+            output << "Unexpected Input in begining or end of Query" << '\n'
+            << "All queries should begin with '#' followed by the test name" << '\n';
             continue;
             }
 
@@ -239,6 +513,7 @@ int Parsefile::parseInput(const string& inputFileName, const string& outputFileN
                 }
                 if (value == "driving") mode = Mode::driving;
                 else if (value == "driving-walking") mode = Mode::drivingwalking;
+                else if (value == "driving-walking-pareto") mode = Mode::drivingwalkingpareto;
                 else {
                     err = true;
                     printParseError(output, value, "Mode:<driving>/<driving-walking>");
@@ -293,19 +568,56 @@ int Parsefile::parseInput(const string& inputFileName, const string& outputFileN
             }
         }
 
+        //* Look for the optional Departure of a driving query, a time in minutes after midnight
+        double departure = -1;
+        getline(input, line);
+        if (mode == Mode::driving && line.compare(0, 10, "Departure:") == 0) {
+            if (!parseArgument(line, argument, value) || parseInt(value) < 0 || parseInt(value) >= PROFILE_PERIOD) {
+                err = true;
+                printParseError(output, line, "Departure:<int>");
+                continue;
+            }
+            departure = parseInt(value);
+            getline(input, line);
+        }
+
+        //* Look for the optional limits of the query, without them the ones of the batch hold
+        int64_t deadline = -1, maxSettled = -1;
+        if (line.compare(0, 9, "Deadline:") == 0) {
+            if (!parseArgument(line, argument, value) || (deadline = parseInt(value)) < 0) {
+                err = true;
+                printParseError(output, line, "Deadline:<int>");
+                continue;
+            }
+            getline(input, line);
+        }
+        if (line.compare(0, 11, "MaxSettled:") == 0) {
+            if (!parseArgument(line, argument, value) || (maxSettled = parseInt(value)) < 0) {
+                err = true;
+                printParseError(output, line, "MaxSettled:<int>");
+                continue;
+            }
+            getline(input, line);
+        }
+
         //* Checking if the next line is empty to know if we can end our query here or not
         {
-            getline(input, line);
             if (line.empty()) {
                 //* upon finding an emptyline with the driving mode we can end the query here
                 if (mode == Mode::driving) {
-                    interface.outputIndependentResult(source, destination, g, output);
+                    queueQuery({ mode, true, source, destination, {}, {}, {}, false, INF, false, 0, name, departure, deadline, maxSettled }, text);
+                    continue;
+                }
+                //* a pareto query without restrictions
+                if (mode == Mode::drivingwalkingpareto) {
+                    queueQuery({ mode, false, source, destination, {}, {}, {}, false, INF, false, 0, name, -1, deadline, maxSettled }, text);
                     continue;
                 }
                 //* if not then there is an error, because the formating for the mode was not completed
                 else {
-                    output << "Unexpected Empty line found, Missing multiple Arguments" << endl;
-                    output << endl;
+                    Metrics::add(Metrics::parseErrors);
+                    output << "Unexpected Empty line found, Missing multiple Arguments" << '\n';
+                    output << '\n';
                     continue;
                 }
             }
@@ -350,7 +662,8 @@ int Parsefile::parseInput(const string& inputFileName, const string& outputFileN
             }
             if (!parseAvoidVertex(value, g, nAvoid)) {
                 err = true;
-                output << "Avoid Nodes had one or more invalid <id>/>code> or invalid syntax" << endl;
+                Metrics::add(Metrics::parseErrors);
+                output << "Avoid Nodes had one or more invalid <id>/>code> or invalid syntax" << '\n';
                 continue;
             }
         }
@@ -370,12 +683,13 @@ int Parsefile::parseInput(const string& inputFileName, const string& outputFileN
             }
             if (!parseAvoidEdge(value, g, eAvoid)) {
                 err = true;
-                output << "Avoid Segments had one or more invalid <id>/>code>" << endl;
+                Metrics::add(Metrics::parseErrors);
+                output << "Avoid Segments had one or more invalid <id>/>code>" << '\n';
                 continue;
             }
         }
 
-        //* Look for Node include, first half of string should be exactly IncludeNode
+        //* Look for Node include, first half of string should be exactly IncludeNode, or IncludeNodes/IncludeNodesAnyOrder for several
 
         if (mode == Mode::driving) {
             getline(input, line);
@@ -384,19 +698,31 @@ int Parsefile::parseInput(const string& inputFileName, const string& outputFileN
                 continue;
             }
             else {
-                if (argument != "IncludeNode") {
-                    err = true;
-                    printParseError(output, argument, "IncludeNode:<id>/<code>");
-                    continue;
+                if (argument == "IncludeNode") {
+                    if (!value.empty()) {
+                        Vertex<int>* must = parseVertex(value, g);
+                        if (must == nullptr) {
+                            err = true;
+                            printParseError(output, value, "Invalid Id/Code");
+                            continue;
+                        }
+                        waypoints.push_back(must);
+                    }
                 }
-                if (!value.empty()) {
-                    must = parseVertex(value, g);
-                    if (must == nullptr) {
+                else if (argument == "IncludeNodes" || argument == "IncludeNodesAnyOrder") {
+                    anyOrder = (argument == "IncludeNodesAnyOrder");
+                    if (!parseAvoidVertex(value, g, waypoints)) {
                         err = true;
-                        printParseError(output, value, "Invalid Id/Code");
+                        Metrics::add(Metrics::parseErrors);
+                        output << "Include Nodes had one or more invalid <id>/<code>" << '\n';
                         continue;
                     }
                 }
+                else {
+                    err = true;
+                    printParseError(output, argument, "IncludeNode:<id>/<code>");
+                    continue;
+                }
             }
         }
 
@@ -404,7 +730,11 @@ int Parsefile::parseInput(const string& inputFileName, const string& outputFileN
         //* Final Step is to call the according algorithm
         switch (mode) {
         case Mode::driving:
-            interface.outputRestrictedResult(source, destination, nAvoid, eAvoid, must, g, output);
+            queueQuery({ mode, false, source, destination, nAvoid, eAvoid, waypoints, anyOrder, INF, false, 0, name, departure, deadline, maxSettled }, text);
+            break;
+
+        case Mode::drivingwalkingpareto:
+            queueQuery({ mode, false, source, destination, nAvoid, eAvoid, {}, false, INF, false, 0, name, -1, deadline, maxSettled }, text);
             break;
 
         case Mode::drivingwalking:
@@ -419,13 +749,311 @@ int Parsefile::parseInput(const string& inputFileName, const string& outputFileN
                 }
                 else
                     aproximate = true;
-            interface.outputEcoResult(source, destination, nAvoid, eAvoid, maxWalkingTime, aproximate, g, output);
-            if (line.empty()) output << endl;
+            queueQuery({ mode, false, source, destination, nAvoid, eAvoid, {}, false, maxWalkingTime, aproximate, 0, name, -1, deadline, maxSettled }, text);
+            if (line.empty()) output << '\n';
             break;
         }
     }
 
-    output.close();
+    answerQueries(text, file, g);
+    if (format == Output::binaryRequests) {
+        string header;
+        BinaryBatch::appendHeader(header, BinaryBatch::requestMagic, g->getCodeVertex(), requestCount);
+        file.write(header.data(), header.size());
+        file.write(requests.data(), requests.size());
+    }
+    file.close();
     input.close();
+    if (interrupt.isCancelled()) {
+        cerr << "Interrupted, the rest of " << inputFileName << " was not read" << '\n';
+        return 1;
+    }
     return 0;
+}
+
+int Parsefile::convertInput(const string& inputFileName, const string& outputFileName, Graph<int>* g) {
+    format = Output::binaryRequests;
+    requests.clear();
+    requestCount = 0;
+    uint64_t errors = Metrics::get(Metrics::parseErrors);
+    int result = parseInput(inputFileName, outputFileName, g);
+    errors = Metrics::get(Metrics::parseErrors) - errors;
+    if (errors > 0) cerr << errors << " errors found in the input, the queries with them were left out" << '\n';
+    format = Output::textResults;
+    requests.clear();
+    return result;
+}
+
+//* Edge from the vertex at index origin to the one at index destination, nullptr if there is none
+static Edge<int>* findSegment(const vector<Vertex<int>*>& vertices, uint32_t origin, uint32_t destination) {
+    if (origin >= vertices.size() || destination >= vertices.size()) return nullptr;
+    for (Edge<int>* e : vertices[origin]->getAdj()) {
+        if (e->getDest() == vertices[destination]) return e;
+    }
+    return nullptr;
+}
+
+bool Parsefile::readBinaryQuery(const BinaryBatch::RecordView& record, const vector<Vertex<int>*>& vertices, Query& query) {
+    BinaryBatch::QueryView view;
+    if (!BinaryBatch::readQuery(record, view)) return false;
+    const BinaryBatch::BinaryQuery& b = view.query;
+    query = Query();
+    query.name = view.name;
+    query.mode = record.kind == BinaryBatch::drivingWalkingQuery ? Mode::drivingwalking
+        : record.kind == BinaryBatch::drivingWalkingParetoQuery ? Mode::drivingwalkingpareto : Mode::driving;
+    query.independent = query.mode == Mode::driving && !(b.flags & BinaryBatch::restricted);
+    query.anyOrder = b.flags & BinaryBatch::anyOrder;
+    query.aproximate = b.flags & BinaryBatch::aproximate;
+    query.maxWalkTime = query.mode == Mode::drivingwalking ? b.maxWalkTime : INF;
+    query.departure = b.departure >= 0 ? b.departure : -1;
+    query.deadline = b.deadline >= 0 ? b.deadline : -1;
+    query.maxSettled = b.maxSettled >= 0 ? b.maxSettled : -1;
+    query.slot = 0;
+    //* the same queries the text format can hold, an independent query has no restrictions and only driving ones include vertices
+    if (query.independent && (b.avoidNodeCount != 0 || b.avoidSegmentCount != 0 || b.includeCount != 0)) return false;
+    if (query.mode != Mode::driving && (b.includeCount != 0 || b.departure >= 0)) return false;
+    if (b.departure >= PROFILE_PERIOD) return false;
+    if (b.source >= vertices.size() || b.destination >= vertices.size()) return false;
+    query.source = vertices[b.source];
+    query.destination = vertices[b.destination];
+    for (uint32_t i = 0; i < b.avoidNodeCount; i++) {
+        if (view.avoidNodes[i] >= vertices.size()) return false;
+        query.nAvoid.push_back(vertices[view.avoidNodes[i]]);
+    }
+    for (uint32_t i = 0; i < b.avoidSegmentCount; i++) {
+        Edge<int>* e = findSegment(vertices, view.avoidSegments[2 * i], view.avoidSegments[2 * i + 1]);
+        if (e == nullptr) return false;
+        query.eAvoid.push_back(e);
+    }
+    for (uint32_t i = 0; i < b.includeCount; i++) {
+        if (view.include[i] >= vertices.size()) return false;
+        query.waypoints.push_back(vertices[view.include[i]]);
+    }
+    return true;
+}
+
+int Parsefile::parseBinaryInput(const string& inputFileName, const string& outputFileName, Graph<int>* g) {
+    BinaryBatch::Reader input(inputFileName, BinaryBatch::requestMagic);
+    if (!input.isValid() || input.getHeader().vertexCount != (uint32_t)g->getCodeVertex()) {
+        cerr << "Error occurred when opening Input file, not a binary requests file for this graph" << '\n';
+        return 1;
+    }
+    ofstream file(outputFileName, ios::out | ios::binary);
+    format = Output::binaryResults;
+    vector<Vertex<int>*> vertices = g->getVertexSet();
+    indices.clear();
+    for (Vertex<int>* v : vertices) indices[v->getInfo()] = v->getIndex();
+    //* result records are written here first, like the text in parseInput, and moved to the file by answerQueries in order
+    string text;
+    BinaryBatch::appendHeader(text, BinaryBatch::resultMagic, vertices.size(), input.getHeader().recordCount);
+
+    BinaryBatch::RecordView record;
+    unsigned count = 0;
+    bool corrupt = false;
+    BatchInterrupt interrupt;
+    while (!corrupt && !interrupt.isCancelled() && input.next(record)) {
+        switch (record.kind) {
+        case BinaryBatch::drivingQuery:
+        case BinaryBatch::drivingWalkingQuery:
+        case BinaryBatch::drivingWalkingParetoQuery: {
+            Query query;
+            if (readBinaryQuery(record, vertices, query)) queueQuery(query, text);
+            else BinaryBatch::appendInvalid(text, query.name);
+            if (pending.size() >= BATCH_WINDOW) answerQueries(text, file, g);
+            break;
+        }
+        case BinaryBatch::update: {
+            BinaryBatch::BinaryUpdate update;
+            memcpy(&update, record.body, min<size_t>(record.size, sizeof(update)));
+            Edge<int>* e = findSegment(vertices, update.origin, update.destination);
+            if (record.size < sizeof(update) || e == nullptr) {
+                corrupt = true;
+                break;
+            }
+            //* queries read so far must see the old times, so they are answered before the change
+            answerQueries(text, file, g);
+            CLInterface interface;
+            interface.updateEdge(e, update.walkTime, update.driveTime, g);
+            BinaryBatch::appendUpdate(text, e, update.driveTime, update.walkTime);
+            break;
+        }
+        case BinaryBatch::engine: {
+            BinaryBatch::BinaryEngine engine;
+            if (record.size < sizeof(engine)) {
+                corrupt = true;
+                break;
+            }
+            memcpy(&engine, record.body, sizeof(engine));
+            if (engine.engine > CLInterface::Engine::multiLevelOverlay) {
+                corrupt = true;
+                break;
+            }
+            answerQueries(text, file, g);
+            CLInterface interface;
+            interface.setEngine((CLInterface::Engine)engine.engine, g);
+            BinaryBatch::appendEngine(text, engine.engine);
+            break;
+        }
+        default:
+            corrupt = true;
+        }
+        if (!corrupt) count++;
+    }
+
+    answerQueries(text, file, g);
+    file.close();
+    format = Output::textResults;
+    if (interrupt.isCancelled()) {
+        cerr << "Interrupted after record " << count << " of " << inputFileName << '\n';
+        return 1;
+    }
+    if (corrupt || !input.isComplete()) {
+        cerr << "Invalid or missing binary record " << count << " in " << inputFileName << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+int Parsefile::parseRegionInput(const string& directory, const string& inputFileName, const string& outputFileName) {
+    RegionStore store;
+    if (!store.open(directory)) {
+        cerr << "Error occurred when opening " << directory << ", it has no partitioned graph" << '\n';
+        return 1;
+    }
+    BinaryBatch::Reader input(inputFileName, BinaryBatch::requestMagic);
+    if (!input.isValid() || input.getHeader().vertexCount != store.vertexCount()) {
+        cerr << "Error occurred when opening Input file, not a binary requests file for this graph" << '\n';
+        return 1;
+    }
+    ofstream file(outputFileName, ios::out | ios::binary);
+    string text;
+    BinaryBatch::appendHeader(text, BinaryBatch::resultMagic, store.vertexCount(), input.getHeader().recordCount);
+
+    BinaryBatch::RecordView record;
+    BinaryBatch::QueryView view;
+    vector<int> path;
+    unsigned count = 0;
+    bool corrupt = false, change = false;
+    while (!corrupt && input.next(record)) {
+        //* the region files are never changed and have a search of their own, engines don't apply to them
+        if (record.kind == BinaryBatch::update || record.kind == BinaryBatch::engine) {
+            change = true;
+            break;
+        }
+        bool isQuery = record.kind == BinaryBatch::drivingQuery || record.kind == BinaryBatch::drivingWalkingQuery
+            || record.kind == BinaryBatch::drivingWalkingParetoQuery;
+        if (!isQuery || !BinaryBatch::readQuery(record, view)) {
+            corrupt = true;
+            break;
+        }
+        const BinaryBatch::BinaryQuery& b = view.query;
+        bool shortest = record.kind == BinaryBatch::drivingQuery && b.departure < 0
+            && b.avoidNodeCount == 0 && b.avoidSegmentCount == 0 && b.includeCount == 0
+            && b.source < store.vertexCount() && b.destination < store.vertexCount();
+        if (shortest) {
+            double time = store.query(b.source, b.destination, Distance::drive, &path);
+            //* like the other driving routes, one that was not found has no path and a time of 0
+            if (time <= 0) path.clear();
+            BinaryBatch::appendRoute(text, view.name, b.source, b.destination, max(time, 0.0), path);
+        }
+        else {
+            BinaryBatch::appendInvalid(text, view.name);
+        }
+        count++;
+        if (count % BATCH_WINDOW == 0) {
+            file.write(text.data(), text.size());
+            text.clear();
+        }
+    }
+
+    file.write(text.data(), text.size());
+    file.close();
+    if (change) {
+        cerr << "Binary record " << count << " in " << inputFileName << " is an update or engine change, which can't be answered from regions" << '\n';
+        return 1;
+    }
+    if (corrupt || !input.isComplete()) {
+        cerr << "Invalid or missing binary record " << count << " in " << inputFileName << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+void Parsefile::queueQuery(const Query& query, string& text) {
+    if (format == Output::binaryRequests) {
+        uint32_t flags = (query.mode == Mode::driving && !query.independent ? (uint32_t)BinaryBatch::restricted : 0u)
+            | (query.anyOrder ? (uint32_t)BinaryBatch::anyOrder : 0u) | (query.aproximate ? (uint32_t)BinaryBatch::aproximate : 0u);
+        static const BinaryBatch::RecordKind kinds[] = { BinaryBatch::drivingQuery, BinaryBatch::drivingWalkingQuery, BinaryBatch::drivingWalkingParetoQuery };
+        BinaryBatch::appendQuery(requests, kinds[query.mode],
+            flags, query.name, query.source, query.destination, query.maxWalkTime, query.departure, query.deadline, query.maxSettled, query.nAvoid, query.eAvoid, query.waypoints);
+        requestCount++;
+        text.clear();
+        return;
+    }
+    segments.push_back(move(text));
+    text.clear();
+    pending.push_back(query);
+    pending.back().slot = segments.size();
+    segments.push_back("");
+}
+
+void Parsefile::answerQueries(string& text, ostream& file, Graph<int>* g) {
+    //* when converting nothing is answered and the text (query names, errors) is not written
+    if (format == Output::binaryRequests) {
+        text.clear();
+        return;
+    }
+    segments.push_back(move(text));
+    text.clear();
+
+    //* Group by the driving tree the first search of each query builds (its source and avoid sets), then by destination
+    //* within a group. Eco queries to the same destination from other sources stay in their own groups, so their
+    //* walking trees are only shared through the tree cache
+    vector<PathTreeKey> keys;
+    vector<unsigned> order;
+    for (unsigned i = 0; i < pending.size(); i++) {
+        Query& q = pending[i];
+        keys.push_back(ShortestPathTreeCache<int>::makeKey(q.source, Distance::drive, q.nAvoid, q.eAvoid));
+        order.push_back(i);
+    }
+    stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+        if (keys[a] == keys[b]) return pending[a].destination->getIndex() < pending[b].destination->getIndex();
+        return keys[a] < keys[b];
+    });
+
+    CLInterface interface;
+    QueryResult result;
+    for (unsigned i : order) {
+        Query& q = pending[i];
+        CLInterface::limitQueries(q.deadline, q.maxSettled);
+        if (q.mode == Mode::drivingwalkingpareto) {
+            interface.paretoResult(q.source, q.destination, q.nAvoid, q.eAvoid, g, result);
+        }
+        else if (q.mode == Mode::drivingwalking) {
+            interface.ecoResult(q.source, q.destination, q.nAvoid, q.eAvoid, q.maxWalkTime, q.aproximate, g, result);
+        }
+        else if (q.independent) {
+            interface.independentResult(q.source, q.destination, g, result, q.departure);
+        }
+        else {
+            interface.restrictedResult(q.source, q.destination, q.nAvoid, q.eAvoid, q.waypoints, q.anyOrder, g, result, q.departure);
+        }
+        if (format == Output::binaryResults) {
+            BinaryBatch::appendResult(segments[q.slot], q.name, result, indices);
+        }
+        else {
+            OutputSink out(segments[q.slot]);
+            result.writeText(out);
+        }
+    }
+
+    CLInterface::limitQueries(-1, -1);
+
+    //* the only flush of the output file, once per group of queries
+    for (const string& segment : segments) {
+        file.write(segment.data(), segment.size());
+    }
+    file.flush();
+    pending.clear();
+    segments.clear();
 }
\ No newline at end of file
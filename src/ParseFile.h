@@ -2,11 +2,15 @@
 #define PARSE_FILE_H
 
 #include <fstream>
+#include <ostream>
 #include <sstream>
 #include <string>
 #include <Graph.h>
 #include <algorithm>
+#include <unordered_map>
 #include <vector>
+#include <TravelTimeProfiles.h>
+#include "BinaryBatch.h"
 
 class Parsefile
 {
@@ -15,6 +19,7 @@ public:
     {
         driving,
         drivingwalking,
+        drivingwalkingpareto,
     };
     /**
      * @brief Parses a file to extract location data and populates the given graph.
@@ -47,11 +52,28 @@ public:
      */
     int parseDistance(const std::string& filename, Graph<int>* g);
 
+    /**
+     * @brief Parses a file of travel time profiles (see TravelTimeProfiles) for the segments of a graph.
+     *
+     * Every row, after a header, is `<code>,<code>,<departure>,<drive>`: driving through the segment from the first
+     * location to the second one, entering it <departure> minutes after midnight, takes <drive> minutes. The rows of a
+     * segment make its profile, in any order, and only that direction gets it. Segments without rows keep their
+     * fixed drive time at any time.
+     *
+     * @param profiles Filled with the profiles, after being cleared.
+     * @return 0 for success, 1 if a row names a segment that does not exist or can't be driven, has an invalid
+     * value, or the rows of a segment repeat a departure or are not FIFO.
+     *
+     * O(R log R) time complexity, where R is the amount of rows.
+     */
+    int parseProfiles(const std::string& filename, Graph<int>* g, TravelTimeProfiles<int>& profiles);
+
     /**
      * @brief Parses input from a file to execute queries on a graph and writes the results to an output file.
      *
      * This function reads a structured input file containing queries and their parameters, processes the queries,
-     * and writes the results to an output file. It supports two modes of operation: "driving" and "driving-walking".
+     * and writes the results to an output file. It supports three modes of operation: "driving", "driving-walking"
+     * and "driving-walking-pareto".
      *
      * @param inputFileName The name of the input file containing the queries.
      * @param outputFileName The name of the output file where results will be written.
@@ -63,17 +85,29 @@ public:
      * - Each query starts with a line beginning with `#` followed by the query name.
      * - Queries are separated by empty lines.
      * - Each query contains the following parameters:
-     *   - `Mode:<driving>/<driving-walking>`: Specifies the mode of operation.
+     *   - `Mode:<driving>/<driving-walking>/<driving-walking-pareto>`: Specifies the mode of operation.
      *   - `Source:<id>/<code>`: Specifies the source vertex.
      *   - `Destination:<id>/<code>`: Specifies the destination vertex.
+     *   - For "driving" mode, an optional parameter:
+     *     - `Departure:<int>`: Minutes after midnight the route starts at, the drive times are then the ones of the
+     *       travel time profiles at the time each segment is reached (see CLInterface::getProfiles).
+     *   - For every mode, optional parameters after those, in this order:
+     *     - `Deadline:<int>`: Milliseconds the query may take, 0 for no limit.
+     *     - `MaxSettled:<int>`: Vertices its searches may settle, 0 for no limit.
+     *     A query over either is answered with Timeout. Without them the limits of QUERY_DEADLINE_MS and
+     *     QUERY_MAX_SETTLED hold, see CLInterface::limitQueries.
      *   - For "driving-walking" mode, an additional parameter:
      *     - `MaxWalkTime:<int>`: Specifies the maximum walking time.
      *   - `AvoidNodes:<id>/<code>,...`: Specifies nodes to avoid.
      *   - `AvoidSegments:(<id>/<code>,<id>/<code>),...`: Specifies edges to avoid.
      *   - For "driving" mode, an additional parameter:
      *     - `IncludeNode:<id>/<code>`: Specifies a node that must be included in the path.
+     *       Several can be given with `IncludeNodes:<id>/<code>,<id>/<code>,...`, visited in the given order,
+     *       or `IncludeNodesAnyOrder:<id>/<code>,...`, visited in the order that gives the shortest route.
      *   - For "driving-walking" mode, an optional parameter:
      *     - `Aproximate`: Indicates whether to use approximate results.
+     *   - "driving-walking-pareto" mode takes only the avoid lists, which can be left out along with the lines
+     *     after them, like a driving query without restrictions.
      *
      * The function validates the input format and parameters. If an error occurs during parsing, it writes an
      * appropriate error message to the output file and skips to the next query.
@@ -84,9 +118,132 @@ public:
      * - For "driving-walking" mode:
      *   - Outputs results for eco-friendly paths considering avoid nodes, avoid edges, maximum walking time,
      *     and optional approximation.
+     * - For "driving-walking-pareto" mode:
+     *   - Outputs every route through a parking node that no other route beats in both drive and walk time,
+     *     see CLInterface::paretoResult.
+     *
+     * Outside of a query, a line `Update:(<id>/<code>,<id>/<code>),<drive>/X,<walk>` changes the times of that segment
+     * (in both directions). Every query before it is answered with the old times and every query after it with the new ones.
+     * A line `Engine:<dijkstra>/<cch>/<crp>` chooses the engine used by the queries after it, see CLInterface::setEngine.
+     *
+     * Valid queries are not answered right away, they are collected (up to BATCH_WINDOW at a time) and answered
+     * grouped by the origin of their search, see answerQueries. Results are still written in the input order.
+     *
+     * An input file in the binary requests format is detected by its magic number and answered by parseBinaryInput.
+     *
+     * A SIGINT while the file is answered cancels its queries (see CLInterface::getCancellation): the results of the
+     * queries read so far are still written, the ones not answered yet being Timeout, the rest of the file is not read
+     * and 1 is returned. A second SIGINT ends the program.
      */
     int parseInput(const std::string& inputFileName, const std::string& outputFileName, Graph<int>* g);
 
+    /**
+     * @brief Answers a file in the binary requests format (see BinaryBatch.h), writing a file in the binary results format.
+     *
+     * Queries are answered the same way as in parseInput, the records are read in place from the mapped file.
+     * A query record that names vertices or segments that don't exist gets an invalidQuery result.
+     *
+     * @return 0 on success, 1 if the input file is not a binary requests file for g, a record in it is corrupt or
+     * a SIGINT cancelled it, in which case the results of the records before it are still written.
+     */
+    int parseBinaryInput(const std::string& inputFileName, const std::string& outputFileName, Graph<int>* g);
+
+    /**
+     * @brief Answers a file in the binary requests format from a graph written by GraphPartition::write in directory,
+     * with a RegionStore, so neither the CSV files nor the whole graph are loaded.
+     *
+     * Only shortest routes can be found this way: a driving query without avoided or included vertices, avoided
+     * segments or departure gets a restrictedResult with its shortest driving route (an independent one gets no
+     * alternative route, which needs the whole graph). Any other query gets an invalidQuery result.
+     *
+     * @return 0 on success, 1 if directory has no partitioned graph, the input file is not a binary requests file for
+     * it, or a record in it is corrupt or an update or engine change, in which case the results of the records before
+     * it are still written.
+     *
+     * O(R (S + E_S) log S) time complexity, where R is the amount of records, see RegionStore::query.
+     */
+    int parseRegionInput(const std::string& directory, const std::string& inputFileName, const std::string& outputFileName);
+
+    /**
+     * @brief Converts a text input file to the binary requests format, without answering it.
+     *
+     * Queries with errors, which parseInput would answer with an error message, are left out and counted on cerr.
+     *
+     * @return 0 on success, 1 if the input file could not be opened.
+     */
+    int convertInput(const std::string& inputFileName, const std::string& outputFileName, Graph<int>* g);
+
+    //* Maximum amount of queries held in memory before they are answered and written
+    static const unsigned BATCH_WINDOW = 4096;
+
+private:
+    /**
+     * @brief A query that was already parsed and validated, waiting to be answered.
+     */
+    struct Query
+    {
+        Mode mode;
+        bool independent; //* driving query without restrictions (Independent Planning)
+        Vertex<int>* source;
+        Vertex<int>* destination;
+        std::vector<Vertex<int>*> nAvoid;
+        std::vector<Edge<int>*> eAvoid;
+        std::vector<Vertex<int>*> waypoints; //* nodes that must be included, in order unless anyOrder
+        bool anyOrder;
+        double maxWalkTime;
+        bool aproximate;
+        unsigned slot; //* position of its result in segments
+        std::string name; //* text after the '#', only kept for the binary formats
+        double departure = -1; //* time dependent driving queries only
+        int64_t deadline = -1;   //* limits of the query, -1 for the ones of the batch (see CLInterface::limitQueries)
+        int64_t maxSettled = -1;
+    };
+
+    //* What is written to the output file
+    enum class Output
+    {
+        textResults,
+        binaryResults,  //* parseBinaryInput
+        binaryRequests, //* convertInput
+    };
+    Output format = Output::textResults;
+    //* index of every vertex id, binary results hold indices
+    std::unordered_map<int, int> indices;
+    //* records converted by convertInput, written once the amount is known
+    std::string requests;
+    unsigned requestCount = 0;
+
+    std::vector<Query> pending;
+    //* Text to be written to the output file in order, query results fill the slots left for them
+    std::vector<std::string> segments;
+
+    /**
+     * @brief Queues a query to be answered later, leaving an empty slot for its result after the text written so far,
+     * which is moved out of text. When converting, the query goes straight to requests and text is dropped instead.
+     */
+    void queueQuery(const Query& query, std::string& text);
+
+    /**
+     * @brief Answers every queued query and writes all pending text, in the original order, to file.
+     * This is the only place the file is flushed, once per group of queries instead of at every line.
+     *
+     * Queries are reordered so that the ones searching from the same source with the same avoid sets run
+     * one after the other. The first of each group runs
+     * the search and the rest reuse its shortest path tree from the tree cache, so a batch with locality costs
+     * one search per group instead of one per query.
+     *
+     * O(Q log Q) time complexity for the grouping, where Q is the amount of queued queries, plus the searches.
+     */
+    void answerQueries(std::string& text, std::ostream& file, Graph<int>* g);
+
+    /**
+     * @brief Reads a query record of a binary requests file.
+     *
+     * @param vertices The vertices of the graph, by index.
+     * @return false if the record names vertices or segments that don't exist or can't be written in the text format.
+     */
+    bool readBinaryQuery(const BinaryBatch::RecordView& record, const std::vector<Vertex<int>*>& vertices, Query& query);
+
 };
 /* Auxiliary Methods */
 
@@ -0,0 +1,21 @@
+#include "QueryBudget.h"
+using namespace std;
+
+thread_local QueryBudget* QueryBudget::current = nullptr;
+
+QueryBudget::QueryBudget(const QueryLimits& limits, const CancellationToken* token) : previous(current), token(token),
+    hasDeadline(limits.deadline.count() > 0), end(chrono::steady_clock::now() + limits.deadline), maxSettled(limits.maxSettled) {
+    current = this;
+    check(); // a query started after a cancellation stops at once
+}
+
+QueryBudget::~QueryBudget() {
+    current = previous;
+}
+
+bool QueryBudget::check() {
+    if (stop != none) return false;
+    if (token != nullptr && token->isCancelled()) stop = cancelled;
+    else if (hasDeadline && chrono::steady_clock::now() >= end) stop = deadline;
+    return stop == none;
+}
@@ -0,0 +1,112 @@
+#ifndef QUERY_BUDGET_H
+#define QUERY_BUDGET_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+//* Settled vertices between two reads of the clock and the cancellation token, a power of two
+#ifndef QUERY_BUDGET_CHECK_INTERVAL
+#define QUERY_BUDGET_CHECK_INTERVAL 256
+#endif
+
+/**
+ * @brief Lets another thread stop the queries being answered. Once cancelled, every query stops at its next check
+ * (and the ones started after it right away) until the token is reset.
+ */
+class CancellationToken
+{
+public:
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+    void reset() { cancelled.store(false, std::memory_order_relaxed); }
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> cancelled{false};
+};
+
+//* How much a single query may take, 0 for no limit
+struct QueryLimits
+{
+    std::chrono::milliseconds deadline{0};
+    uint64_t maxSettled = 0; //* vertices settled by all the searches of the query together
+
+    //* These limits with the ones a single query asks for, a negative value keeps the one of these
+    QueryLimits overriddenBy(int64_t deadlineMs, int64_t settled) const {
+        QueryLimits limits = *this;
+        if (deadlineMs >= 0) limits.deadline = std::chrono::milliseconds(deadlineMs);
+        if (settled >= 0) limits.maxSettled = settled;
+        return limits;
+    }
+};
+
+/**
+ * @brief Deadline, settled vertex budget and cancellation of the query being answered on this thread.
+ *
+ * While a budget lives it is the active one of its thread, and the search loops (dijkstra, the time dependent and
+ * bidirectional searches and the Pareto search) call settle once per settled vertex and stop as soon as it returns
+ * false. The settled count is compared every time, the clock and the token only every QUERY_BUDGET_CHECK_INTERVAL
+ * vertices, so a search without limits only pays for an increment and a branch. A stopped search leaves partial
+ * trees behind, so once the budget is exhausted nothing it computed may be kept or cached.
+ */
+class QueryBudget
+{
+public:
+    enum Stop
+    {
+        none,
+        deadline,
+        settledLimit,
+        cancelled,
+    };
+
+    //* Starts the deadline and makes this the active budget of the thread until it is destroyed, exhausted already if the token is cancelled
+    QueryBudget(const QueryLimits& limits, const CancellationToken* token);
+    ~QueryBudget();
+
+    QueryBudget(const QueryBudget&) = delete;
+    QueryBudget& operator=(const QueryBudget&) = delete;
+
+    //* The budget of the query being answered on this thread, nullptr if there is none
+    static QueryBudget* active() { return current; }
+
+    /**
+     * @brief Counts one settled vertex.
+     *
+     * @return false if the query must stop, and for every call after that.
+     *
+     * O(1) time complexity.
+     */
+    bool settle() {
+        if (stop != none) return false;
+        settled++;
+        if (maxSettled != 0 && settled > maxSettled) {
+            stop = settledLimit;
+            return false;
+        }
+        return (settled & (QUERY_BUDGET_CHECK_INTERVAL - 1)) != 0 || check();
+    }
+
+    /**
+     * @brief Reads the clock and the cancellation token.
+     *
+     * @return false if the query must stop.
+     */
+    bool check();
+
+    bool isExhausted() const { return stop != none; }
+    Stop getStop() const { return stop; }
+    uint64_t getSettled() const { return settled; }
+
+private:
+    static thread_local QueryBudget* current;
+    QueryBudget* previous;
+    const CancellationToken* token;
+    bool hasDeadline;
+    std::chrono::steady_clock::time_point end;
+    uint64_t maxSettled;
+    uint64_t settled = 0;
+    Stop stop = none;
+};
+
+#endif //QUERY_BUDGET_H
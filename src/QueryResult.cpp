@@ -0,0 +1,98 @@
+#include "QueryResult.h"
+using namespace std;
+
+static void writePath(const vector<int>& path, OutputSink& out) {
+    if (path.empty()) return;
+    out << path[0];
+    for (size_t i = 1; i < path.size(); i++) {
+        out << ',' << path[i];
+    }
+}
+
+//* A driving route line of an independent or restricted result, "none" when it was not found
+static void writeDrivingRoute(const char* label, const QueryResult::Route& route, OutputSink& out) {
+    out << label;
+    if (route.driveTime > 0) {
+        writePath(route.drivePath, out);
+        out << '(' << route.driveTime << ')' << '\n';
+    }
+    else {
+        out << "none" << '\n';
+    }
+}
+
+//* The four lines of an eco route, numbered when it is one of the approximations
+static void writeEcoRoute(const QueryResult::Route& route, OutputSink& out) {
+    string number = route.number != 0 ? to_string(route.number) : "";
+    out << "DrivingRoute" << number << ":";
+    writePath(route.drivePath, out);
+    out << '(' << route.driveTime << ')' << '\n';
+    out << "ParkingNode" << number << ":" << route.parking->getInfo() << '\n';
+    out << "WalkingRoute" << number << ":";
+    writePath(route.walkPath, out);
+    out << '(' << route.walkTime << ')' << '\n';
+    out << "TotalTime" << number << ":" << route.walkTime + route.driveTime << '\n';
+}
+
+void QueryResult::writeText(OutputSink& out) const {
+    out << "Source:" << source->getInfo() << '\n';
+    out << "Destination:" << destination->getInfo() << '\n';
+    if (departure >= 0) out << "Departure:" << departure << '\n';
+    if (stopped != QueryBudget::none) {
+        static const char* reasons[] = { "", "deadline", "settled", "cancelled" };
+        out << "Timeout:" << reasons[stopped] << '\n';
+        //* eco routes end without an empty line, like a route that was found
+        if (kind != eco) out << '\n';
+        return;
+    }
+
+    switch (kind) {
+    case independent:
+        writeDrivingRoute("BestDrivingRoute:", routes[0], out);
+        writeDrivingRoute("AlternativeDrivingRoute:", routes[1], out);
+        out << '\n';
+        break;
+
+    case restricted:
+        writeDrivingRoute("RestrictedDrivingRoute:", routes[0], out);
+        out << '\n';
+        break;
+
+    case eco:
+        if (found) {
+            writeEcoRoute(routes[0], out);
+        }
+        else if (!aproximate) {
+            out << "DrivingRoute:" << '\n';
+            out << "ParkingNode:" << '\n';
+            out << "TotalTime:" << '\n';
+            out << "Message: no possible route with max. walking time of " << maxWalkTime << " minutes." << '\n';
+        }
+        else {
+            for (const Route& route : routes) writeEcoRoute(route, out);
+            for (unsigned i = listed + 1; i <= 2; i++) {
+                out << "DrivingRoute" << (int)i << ":" << '\n';
+                out << "ParkingNode" << (int)i << ":" << '\n';
+                out << "WalkingRoute" << (int)i << ":" << '\n';
+                out << "TotalTime" << (int)i << ":" << '\n';
+            }
+            out << '\n';
+        }
+        break;
+
+    case pareto:
+        out << "ParetoRoutes:" << (int)routes.size() << '\n';
+        for (const Route& route : routes) writeEcoRoute(route, out);
+        if (routes.empty()) out << "Message: no possible route through a parking node." << '\n';
+        out << '\n';
+        break;
+    }
+}
+
+size_t QueryResult::memoryUsage() const {
+    size_t size = sizeof(QueryResult) + routes.capacity() * sizeof(Route);
+    for (const Route& route : routes) {
+        size += (route.drivePath.capacity() + route.walkPath.capacity()) * sizeof(int);
+    }
+    return size;
+}
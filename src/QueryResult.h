@@ -0,0 +1,72 @@
+#ifndef QUERY_RESULT_H
+#define QUERY_RESULT_H
+
+#include <string>
+#include <vector>
+#include <Graph.h>
+#include "OutputSink.h"
+#include "QueryBudget.h"
+
+/**
+ * @brief Answer to one query, kept as data so it can be cached and then written either as text or in the binary
+ * result format (see BinaryBatch.h).
+ *
+ * Paths hold vertex ids, in order from the start of the route. A driving route that was not found has no path and
+ * a time of 0. With a departure time, drive times are the ones of the travel time profiles at that time.
+ * Which routes a result holds depends on its kind:
+ * - independent: the best and the alternative driving routes, in that order.
+ * - restricted: the restricted driving route.
+ * - eco: the route through the chosen parking when found, otherwise the approximations (if asked for), each with
+ *   the number it is listed with.
+ * - pareto: every route of the drive time / walk time Pareto frontier (see ParetoSearch), numbered from 1 by
+ *   increasing drive time.
+ * A query stopped by its deadline, settled vertex budget or cancellation (see QueryBudget) has no routes whatever its
+ * kind, only the reason it was stopped.
+ */
+struct QueryResult
+{
+    enum Kind
+    {
+        independent,
+        restricted,
+        eco,
+        pareto,
+    };
+
+    struct Route
+    {
+        double driveTime = 0;
+        std::vector<int> drivePath;
+        //* eco routes only
+        Vertex<int>* parking = nullptr;
+        double walkTime = 0;
+        std::vector<int> walkPath;
+        unsigned number = 0; //* position in the list of approximations, 0 for any other route
+    };
+
+    Kind kind = independent;
+    Vertex<int>* source = nullptr;
+    Vertex<int>* destination = nullptr;
+    std::vector<Route> routes;
+    double departure = -1; //* of a time dependent driving query, -1 if it had none
+    QueryBudget::Stop stopped = QueryBudget::none;
+    //* eco and pareto results only
+    bool found = false;
+    bool aproximate = false;
+    double maxWalkTime = 0;
+    unsigned listed = 0; //* parking nodes looked at for the approximations, the numbers after it are listed empty
+
+    /**
+     * @brief Writes the result in the text output format, the same lines the batch and the interactive modes print.
+     *
+     * O(P) time complexity, where P is the length of the paths.
+     */
+    void writeText(OutputSink& out) const;
+
+    /**
+     * @brief Approximate amount of memory used by the result, including its paths.
+     */
+    size_t memoryUsage() const;
+};
+
+#endif //QUERY_RESULT_H
@@ -0,0 +1,153 @@
+#include "RegionStore.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <utility>
+using namespace std;
+using namespace RegionFormat;
+
+bool RegionStore::open(const string& directory) {
+    prefix = directory.empty() || directory.back() == '/' ? directory : directory + "/";
+    regions.clear();
+    loaded = 0;
+    header = {};
+    overlay.reset(new MappedFile(prefix + "overlay.bin"));
+    if (!overlay->isOpen() || overlay->size() < sizeof(OverlayHeader)) return false;
+    memcpy(&header, overlay->data(), sizeof(OverlayHeader));
+    if (memcmp(header.magic, overlayMagic, sizeof(header.magic)) != 0 || header.version != version) return false;
+
+    uint64_t words = 2 * (uint64_t)header.vertexCount + header.regionCount + 1 + 2 * (uint64_t)header.boundaryCount + 1;
+    uint64_t offset = (sizeof(OverlayHeader) + 4 * words + 7) / 8 * 8;
+    uint64_t size = offset + 8 * ((uint64_t)header.regionCount + 1) + 16 * header.cliqueSize + sizeof(CutEdge) * (uint64_t)header.cutEdgeCount;
+    if (overlay->size() < size) return false;
+    const char* data = overlay->data();
+    region = reinterpret_cast<const uint32_t*>(data + sizeof(OverlayHeader));
+    local = region + header.vertexCount;
+    boundaryOffsets = local + header.vertexCount;
+    boundary = boundaryOffsets + header.regionCount + 1;
+    cutOffsets = boundary + header.boundaryCount;
+    cliqueOffsets = reinterpret_cast<const uint64_t*>(data + offset);
+    cliques[0] = reinterpret_cast<const double*>(cliqueOffsets + header.regionCount + 1);
+    cliques[1] = cliques[0] + header.cliqueSize;
+    cutEdges = reinterpret_cast<const CutEdge*>(cliques[1] + header.cliqueSize);
+    regions.resize(header.regionCount);
+    return true;
+}
+
+const RegionView* RegionStore::view(int r) {
+    Region& reg = regions[r];
+    if (reg.file != nullptr) return reg.valid ? &reg.view : nullptr;
+    reg.file.reset(new MappedFile(prefix + "region" + to_string(r) + ".bin"));
+    loaded++;
+    const MappedFile& file = *reg.file;
+    if (!file.isOpen() || file.size() < sizeof(RegionHeader)) return nullptr;
+    RegionHeader h;
+    memcpy(&h, file.data(), sizeof(RegionHeader));
+    if (memcmp(h.magic, regionMagic, sizeof(h.magic)) != 0 || h.version != version || h.region != (uint32_t)r) return nullptr;
+    uint64_t offset = (sizeof(RegionHeader) + 4 * (3 * (uint64_t)h.vertexCount + 1 + h.edgeCount) + 7) / 8 * 8;
+    if (file.size() < offset + 16 * (uint64_t)h.edgeCount) return nullptr;
+    RegionView& v = reg.view;
+    v.vertexCount = h.vertexCount;
+    v.indices = reinterpret_cast<const uint32_t*>(file.data() + sizeof(RegionHeader));
+    v.ids = reinterpret_cast<const int32_t*>(v.indices + h.vertexCount);
+    v.offsets = reinterpret_cast<const uint32_t*>(v.ids + h.vertexCount);
+    v.targets = v.offsets + h.vertexCount + 1;
+    v.weights[0] = reinterpret_cast<const double*>(file.data() + offset);
+    v.weights[1] = v.weights[0] + h.edgeCount;
+    reg.valid = true;
+    return &v;
+}
+
+int RegionStore::idOf(int index) {
+    if (index < 0 || (uint32_t)index >= header.vertexCount) return -1;
+    const RegionView* v = view(region[index]);
+    return v != nullptr ? v->ids[local[index]] : -1;
+}
+
+bool RegionStore::appendInner(int r, int from, int to, int metric, vector<int>& path) {
+    const RegionView* v = view(r);
+    if (v == nullptr) return false;
+    regionDijkstra(*v, local[from], metric, innerDist, innerParent);
+    size_t first = path.size();
+    for (int w = local[to]; w != (int)local[from]; w = innerParent[w]) {
+        if (w == -1) return false;
+        path.push_back(v->indices[w]);
+    }
+    reverse(path.begin() + first, path.end());
+    return true;
+}
+
+double RegionStore::query(int from, int to, int metric, vector<int>* path) {
+    if (path != nullptr) path->clear();
+    if (from < 0 || to < 0 || (uint32_t)from >= header.vertexCount || (uint32_t)to >= header.vertexCount) return -1;
+    int fromRegion = region[from], toRegion = region[to];
+    const RegionView* ends[2] = { view(fromRegion), view(toRegion) };
+    if (ends[0] == nullptr || ends[1] == nullptr) return -1;
+
+    labels.clear();
+    typedef pair<double, int> Item;
+    priority_queue<Item, vector<Item>, greater<Item>> q;
+    labels[from] = { 0, -1, start };
+    q.push(Item(0, from));
+    auto relax = [&](int v, int w, double dist, Step step) {
+        auto found = labels.find(w);
+        if (found != labels.end() && found->second.dist <= dist) return;
+        labels[w] = { dist, v, step };
+        q.push(Item(dist, w));
+    };
+    while (!q.empty()) {
+        Item item = q.top();
+        q.pop();
+        int v = item.second;
+        if (item.first > labels[v].dist) continue; // outdated entry
+        if (v == to) break;
+        double dist = item.first;
+        int r = region[v], l = local[v];
+        if (r == fromRegion || r == toRegion) {
+            //* inside the regions of the ends every inner edge is followed
+            const RegionView* rv = ends[r == fromRegion ? 0 : 1];
+            const double* weights = rv->weights[metric];
+            for (uint32_t i = rv->offsets[l]; i < rv->offsets[l + 1]; i++) {
+                if (weights[i] != INF) relax(v, rv->indices[rv->targets[i]], dist + weights[i], innerEdge);
+            }
+        }
+        uint32_t b = boundaryOffsets[r + 1] - boundaryOffsets[r];
+        if ((uint32_t)l >= b) continue;
+        if (r != fromRegion && r != toRegion) {
+            //* any other region is crossed between two of its boundary vertices
+            const double* row = cliques[metric] + cliqueOffsets[r] + (uint64_t)l * b;
+            for (uint32_t i = 0; i < b; i++) {
+                if (row[i] != INF && (int)i != l) relax(v, boundary[boundaryOffsets[r] + i], dist + row[i], overlayEdge);
+            }
+        }
+        uint32_t p = boundaryOffsets[r] + l;
+        for (uint32_t i = cutOffsets[p]; i < cutOffsets[p + 1]; i++) {
+            double w = metric == 0 ? cutEdges[i].walkTime : cutEdges[i].driveTime;
+            if (w != INF) relax(v, cutEdges[i].target, dist + w, cutEdge);
+        }
+    }
+    auto found = labels.find(to);
+    if (found == labels.end()) return -1;
+    double total = found->second.dist;
+    if (path == nullptr) return total;
+
+    //* the steps from the destination back, expanded to inner edges
+    vector<int> steps;
+    for (int v = to; v != -1; v = labels[v].parent) steps.push_back(v);
+    reverse(steps.begin(), steps.end());
+    path->push_back(from);
+    for (size_t i = 1; i < steps.size(); i++) {
+        int v = steps[i];
+        if (labels[v].step == overlayEdge) {
+            if (!appendInner(region[v], steps[i - 1], v, metric, *path)) {
+                path->clear();
+                return -1;
+            }
+        }
+        else {
+            path->push_back(v);
+        }
+    }
+    return total;
+}
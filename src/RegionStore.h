@@ -0,0 +1,102 @@
+#ifndef REGION_STORE_H
+#define REGION_STORE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "GraphPartition.h"
+#include "MappedFile.h"
+
+/**
+ * @brief Shortest paths over a graph written by GraphPartition::write, without loading the whole graph.
+ *
+ * Opening maps only overlay.bin. A region file is mapped the first time a search needs the inner edges of its region
+ * and stays mapped afterwards, so memory grows with the regions queries actually touch instead of with the map.
+ *
+ * A query is a dijkstra over the inner edges of the origin and destination regions and the overlay of every other
+ * region: its boundary vertices, their overlay distances and the edges between regions. Any shortest path crosses
+ * a region through its boundary vertices, so the distances are exact while only two regions are loaded. Crossings
+ * of other regions are expanded back to inner edges only when the path is asked for, loading those regions.
+ *
+ * Vertices are given by their index (the line of Locations.csv they come from, counting from 0), as in the binary
+ * batch formats. Queries use internal buffers, so a single instance must not be queried by several threads at once.
+ */
+class RegionStore
+{
+public:
+    /**
+     * @brief Maps the overlay of the partitioned graph in directory. Regions mapped before are dropped.
+     *
+     * @return false if overlay.bin is missing or not valid.
+     */
+    bool open(const std::string& directory);
+
+    uint32_t vertexCount() const { return header.vertexCount; }
+    int regionCount() const { return header.regionCount; }
+    //* Regions mapped so far
+    int loadedRegions() const { return loaded; }
+
+    /**
+     * @brief Shortest path from the vertex at index from to the one at index to.
+     *
+     * @param metric 0 for walking times, 1 for driving times (a Distance).
+     * @param path If not nullptr, filled with the indices of the vertices on the path, from origin to destination.
+     * @return The total distance of the path, -1 if there is no path or a region file is missing or not valid.
+     *
+     * O((S + E_S) log S) time complexity, where S is the amount of vertices of both regions and of the overlay
+     * settled, and E_S their edges, plus a dijkstra inside every region crossed when the path is built.
+     */
+    double query(int from, int to, int metric, std::vector<int>* path = nullptr);
+
+    //* The id of the vertex at index, loading its region, -1 if it can't be loaded
+    int idOf(int index);
+
+private:
+    struct Region
+    {
+        std::unique_ptr<MappedFile> file;
+        RegionFormat::RegionView view;
+        bool valid = false;
+    };
+
+    //* How a search label was reached
+    enum Step : uint8_t
+    {
+        start,
+        innerEdge,
+        overlayEdge, //* overlay distance between two boundary vertices of a region
+        cutEdge,
+    };
+
+    struct Label
+    {
+        double dist;
+        int parent;
+        Step step;
+    };
+
+    std::string prefix;
+    std::unique_ptr<MappedFile> overlay;
+    RegionFormat::OverlayHeader header = {};
+    const uint32_t* region = nullptr;
+    const uint32_t* local = nullptr;
+    const uint32_t* boundaryOffsets = nullptr;
+    const uint32_t* boundary = nullptr;
+    const uint32_t* cutOffsets = nullptr;
+    const uint64_t* cliqueOffsets = nullptr;
+    const double* cliques[2] = { nullptr, nullptr };
+    const RegionFormat::CutEdge* cutEdges = nullptr;
+    std::vector<Region> regions;
+    int loaded = 0;
+    std::unordered_map<int, Label> labels; //* only the vertices the search reached
+    std::vector<double> innerDist;
+    std::vector<int> innerParent;
+
+    //* The region r, mapping its file the first time, nullptr if it can't be loaded
+    const RegionFormat::RegionView* view(int r);
+    //* Adds the inner path of region r between two of its vertices, without the first one, to path
+    bool appendInner(int r, int from, int to, int metric, std::vector<int>& path);
+};
+
+#endif //REGION_STORE_H
@@ -0,0 +1,80 @@
+#include "RelaxKernel.h"
+
+#if RELAX_SIMD && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RELAX_X86
+#include <immintrin.h>
+#endif
+
+typedef uint64_t (*RelaxFunction)(const int*, const double*, int, double, const double*);
+
+#ifdef RELAX_X86
+__attribute__((target("avx2")))
+static uint64_t improvedTargetsAvx2(const int* targets, const double* weights, int count, double dist, const double* labels) {
+    uint64_t improved = 0;
+    __m256d base = _mm256_set1_pd(dist);
+    //* the masked gather with every lane on, the plain one leaves its source register uninitialized
+    __m256d none = _mm256_setzero_pd();
+    __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(targets + i));
+        __m256d current = _mm256_mask_i32gather_pd(none, labels, index, all, 8);
+        __m256d candidate = _mm256_add_pd(base, _mm256_loadu_pd(weights + i));
+        uint64_t lanes = _mm256_movemask_pd(_mm256_cmp_pd(candidate, current, _CMP_LT_OQ));
+        improved |= lanes << i;
+    }
+    if (i < count) improved |= improvedTargetsScalar(targets + i, weights + i, count - i, dist, labels) << i;
+    return improved;
+}
+
+__attribute__((target("sse2")))
+static uint64_t improvedTargetsSse2(const int* targets, const double* weights, int count, double dist, const double* labels) {
+    uint64_t improved = 0;
+    __m128d base = _mm_set1_pd(dist);
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128d current = _mm_loadh_pd(_mm_load_sd(labels + targets[i]), labels + targets[i + 1]);
+        __m128d candidate = _mm_add_pd(base, _mm_loadu_pd(weights + i));
+        uint64_t lanes = _mm_movemask_pd(_mm_cmplt_pd(candidate, current));
+        improved |= lanes << i;
+    }
+    if (i < count) improved |= improvedTargetsScalar(targets + i, weights + i, count - i, dist, labels) << i;
+    return improved;
+}
+#endif
+
+static RelaxFunction pickKernel(const char** name) {
+#ifdef RELAX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return improvedTargetsAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        *name = "sse2";
+        return improvedTargetsSse2;
+    }
+#endif
+    *name = "scalar";
+    return improvedTargetsScalar;
+}
+
+struct KernelChoice
+{
+    const char* name;
+    RelaxFunction function;
+    KernelChoice() { function = pickKernel(&name); }
+};
+
+static const KernelChoice& kernel() {
+    static const KernelChoice chosen;
+    return chosen;
+}
+
+uint64_t improvedTargets(const int* targets, const double* weights, int count, double dist, const double* labels) {
+    return kernel().function(targets, weights, count, dist, labels);
+}
+
+const char* relaxKernelName() {
+    return kernel().name;
+}
@@ -0,0 +1,63 @@
+#ifndef RELAX_KERNEL_H
+#define RELAX_KERNEL_H
+
+#include <cstdint>
+
+//* Set to 0 to always relax edges with the scalar loop
+#ifndef RELAX_SIMD
+#define RELAX_SIMD 1
+#endif
+
+//* Vertices with fewer outgoing edges than this are compared inline, the call to a vector kernel only pays off above it
+#ifndef RELAX_SIMD_MIN_DEGREE
+#define RELAX_SIMD_MIN_DEGREE 8
+#endif
+
+//* Most edges compared by one call, one bit of the result each
+#define RELAX_BLOCK 64
+
+/**
+ * @brief Compares a block of edges leaving a settled vertex against the current labels of their targets.
+ *
+ * Edge i improves its target if dist + weights[i] < labels[targets[i]]. Uses AVX2 (4 edges per step, with gathered
+ * labels) or SSE2 (2 edges per step) when the CPU supports them, chosen once at runtime, and a scalar loop otherwise.
+ * All of them give exactly the same result, the sums are the same IEEE additions.
+ *
+ * @param targets Target of every edge, as an index into labels (a CompactAdjacency position in the searches).
+ * @param weights Weight of every edge.
+ * @param count Amount of edges, at most RELAX_BLOCK.
+ * @param dist Distance of the settled vertex.
+ * @param labels Current distance of every vertex, in the numbering of targets.
+ * @return Bit i set if edge i improves its target.
+ *
+ * O(count) time complexity.
+ */
+uint64_t improvedTargets(const int* targets, const double* weights, int count, double dist, const double* labels);
+
+//* Same as improvedTargets, always with the scalar loop
+inline uint64_t improvedTargetsScalar(const int* targets, const double* weights, int count, double dist, const double* labels) {
+    uint64_t improved = 0;
+    for (int i = 0; i < count; i++) {
+        if (dist + weights[i] < labels[targets[i]]) improved |= uint64_t(1) << i;
+    }
+    return improved;
+}
+
+//* Name of the kernel improvedTargets uses on this CPU: "avx2", "sse2" or "scalar"
+const char* relaxKernelName();
+
+//* Position of the lowest set bit, bits must not be 0
+inline int lowestBit(uint64_t bits) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    int i = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+#endif //RELAX_KERNEL_H
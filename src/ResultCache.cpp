@@ -0,0 +1,185 @@
+#include "ResultCache.h"
+#include <ShortestPathTreeCache.h>
+#include <algorithm>
+#include <functional>
+using namespace std;
+
+const size_t ResultCache::DEFAULT_CAPACITY;
+
+/* QueryKey */
+
+static int vertexIndex(Vertex<int>* v) {
+    return v == nullptr ? -1 : v->getIndex();
+}
+
+bool QueryKey::operator==(const QueryKey& other) const {
+    return kind == other.kind && source == other.source && destination == other.destination
+        && include == other.include && anyOrder == other.anyOrder && maxWalkTime == other.maxWalkTime && aproximate == other.aproximate
+        && departure == other.departure && occupancyVersion == other.occupancyVersion && avoidNodes == other.avoidNodes && avoidSegments == other.avoidSegments;
+}
+
+void QueryKey::setRestrictions(const vector<Vertex<int>*>& nAvoid, const vector<Edge<int>*>& eAvoid) {
+    canonicalRestrictions(nAvoid, eAvoid, avoidNodes, avoidSegments);
+}
+
+QueryKey QueryKey::independentQuery(Vertex<int>* source, Vertex<int>* destination, double departure) {
+    QueryKey key;
+    key.kind = Kind::independent;
+    key.source = vertexIndex(source);
+    key.destination = vertexIndex(destination);
+    key.departure = departure;
+    return key;
+}
+
+QueryKey QueryKey::restrictedQuery(Vertex<int>* source, Vertex<int>* destination, const vector<Vertex<int>*>& nAvoid,
+    const vector<Edge<int>*>& eAvoid, const vector<Vertex<int>*>& waypoints, bool anyOrder, double departure) {
+    QueryKey key;
+    key.kind = Kind::restricted;
+    key.source = vertexIndex(source);
+    key.destination = vertexIndex(destination);
+    key.departure = departure;
+    for (Vertex<int>* v : waypoints) {
+        key.include.push_back(vertexIndex(v));
+    }
+    if (anyOrder && waypoints.size() > 1) {
+        key.anyOrder = true;
+        sort(key.include.begin(), key.include.end());
+        key.include.erase(unique(key.include.begin(), key.include.end()), key.include.end());
+    }
+    key.setRestrictions(nAvoid, eAvoid);
+    return key;
+}
+
+QueryKey QueryKey::ecoQuery(Vertex<int>* source, Vertex<int>* destination, const vector<Vertex<int>*>& nAvoid,
+    const vector<Edge<int>*>& eAvoid, double maxWalkTime, bool aproximate, uint64_t occupancyVersion) {
+    QueryKey key;
+    key.kind = Kind::eco;
+    key.occupancyVersion = occupancyVersion;
+    key.source = vertexIndex(source);
+    key.destination = vertexIndex(destination);
+    key.maxWalkTime = maxWalkTime;
+    key.aproximate = aproximate;
+    key.setRestrictions(nAvoid, eAvoid);
+    return key;
+}
+
+QueryKey QueryKey::paretoQuery(Vertex<int>* source, Vertex<int>* destination, const vector<Vertex<int>*>& nAvoid,
+    const vector<Edge<int>*>& eAvoid, uint64_t occupancyVersion) {
+    QueryKey key;
+    key.kind = Kind::pareto;
+    key.occupancyVersion = occupancyVersion;
+    key.source = vertexIndex(source);
+    key.destination = vertexIndex(destination);
+    key.setRestrictions(nAvoid, eAvoid);
+    return key;
+}
+
+size_t QueryKey::memoryUsage() const {
+    return sizeof(QueryKey) + (include.capacity() + avoidNodes.capacity()) * sizeof(int) + avoidSegments.capacity() * sizeof(pair<int, int>);
+}
+
+size_t QueryKeyHash::operator()(const QueryKey& key) const {
+    //* boost::hash_combine style mixing
+    size_t h = 0;
+    auto combine = [&h](size_t value) { h ^= value + 0x9e3779b9 + (h << 6) + (h >> 2); };
+    combine(key.kind);
+    combine(key.source);
+    combine(key.destination);
+    for (int v : key.include) combine(v);
+    combine(key.anyOrder);
+    combine(hash<double>()(key.maxWalkTime));
+    combine(key.aproximate);
+    combine(hash<double>()(key.departure));
+    combine(key.occupancyVersion);
+    for (int v : key.avoidNodes) combine(v);
+    for (const pair<int, int>& e : key.avoidSegments) {
+        combine(e.first);
+        combine(e.second);
+    }
+    return h;
+}
+
+/* ResultCache */
+
+ResultCache::ResultCache(size_t capacityBytes) : capacity(capacityBytes) {}
+
+size_t ResultCache::entrySize(const Entry& entry) {
+    //* list node + hash map node overhead is roughly 4 pointers
+    return entry.first.memoryUsage() + entry.second.memoryUsage() + 4 * sizeof(void*);
+}
+
+bool ResultCache::lookup(const QueryKey& key, QueryResult& result) {
+    lock_guard<mutex> lock(mtx);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        misses++;
+        return false;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    result = it->second->second;
+    hits++;
+    return true;
+}
+
+void ResultCache::insert(const QueryKey& key, const QueryResult& result) {
+    lock_guard<mutex> lock(mtx);
+    auto it = index.find(key);
+    if (it != index.end()) {
+        usage -= entrySize(*it->second);
+        entries.erase(it->second);
+        index.erase(it);
+    }
+    entries.emplace_front(key, result);
+    size_t size = entrySize(entries.front());
+    if (size > capacity) {
+        entries.pop_front();
+        return;
+    }
+    index[key] = entries.begin();
+    usage += size;
+    evict();
+}
+
+void ResultCache::evict() {
+    while (usage > capacity && !entries.empty()) {
+        usage -= entrySize(entries.back());
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+void ResultCache::clear() {
+    lock_guard<mutex> lock(mtx);
+    entries.clear();
+    index.clear();
+    usage = 0;
+}
+
+unsigned long ResultCache::getHits() const {
+    return hits;
+}
+
+unsigned long ResultCache::getMisses() const {
+    return misses;
+}
+
+size_t ResultCache::getMemoryUsage() const {
+    lock_guard<mutex> lock(mtx);
+    return usage;
+}
+
+size_t ResultCache::getCapacity() const {
+    lock_guard<mutex> lock(mtx);
+    return capacity;
+}
+
+size_t ResultCache::size() const {
+    lock_guard<mutex> lock(mtx);
+    return entries.size();
+}
+
+void ResultCache::setCapacity(size_t capacityBytes) {
+    lock_guard<mutex> lock(mtx);
+    capacity = capacityBytes;
+    evict();
+}
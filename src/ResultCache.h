@@ -0,0 +1,153 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <Graph.h>
+#include "QueryResult.h"
+
+/**
+ * @brief Canonical form of a query, used as the key of the ResultCache.
+ *
+ * Vertices are stored by their index in the graph, so a query given by id and the same query given by code
+ * map to the same key. Avoid lists are sorted and deduplicated and avoided segments are stored as
+ * (smaller index, bigger index) pairs, since avoiding an edge always avoids its reverse as well.
+ * Included nodes keep their order, unless they may be visited in any order, in which case they are sorted.
+ * Driving queries with a departure time (see TravelTimeProfiles) are told apart by it, -1 when there is none,
+ * and queries through car parks by the version of the occupancy they were answered with (see ParkingOccupancy).
+ */
+struct QueryKey
+{
+    enum Kind
+    {
+        independent,
+        restricted,
+        eco,
+        pareto,
+    };
+
+    Kind kind;
+    int source = -1, destination = -1;
+    std::vector<int> include;
+    bool anyOrder = false;
+    std::vector<int> avoidNodes;
+    std::vector<std::pair<int, int>> avoidSegments;
+    double maxWalkTime = 0;
+    bool aproximate = false;
+    double departure = -1;
+    uint64_t occupancyVersion = 0;
+
+    bool operator==(const QueryKey& other) const;
+
+    /**
+     * @brief Builds the key of an independent (unrestricted driving) query.
+     *
+     * @param departure Departure time of a time dependent query, -1 if none.
+     */
+    static QueryKey independentQuery(Vertex<int>* source, Vertex<int>* destination, double departure = -1);
+
+    /**
+     * @brief Builds the key of a restricted driving query.
+     *
+     * @param waypoints The vertices that must be included in the path, empty if none.
+     * @param anyOrder Whether the waypoints may be visited in any order.
+     * @param departure Departure time of a time dependent query, -1 if none.
+     */
+    static QueryKey restrictedQuery(Vertex<int>* source, Vertex<int>* destination, const std::vector<Vertex<int>*>& nAvoid,
+        const std::vector<Edge<int>*>& eAvoid, const std::vector<Vertex<int>*>& waypoints, bool anyOrder, double departure = -1);
+
+    /**
+     * @brief Builds the key of an eco-friendly (driving-walking) query.
+     *
+     * @param occupancyVersion Version of the car park occupancy the query is answered with.
+     */
+    static QueryKey ecoQuery(Vertex<int>* source, Vertex<int>* destination, const std::vector<Vertex<int>*>& nAvoid,
+        const std::vector<Edge<int>*>& eAvoid, double maxWalkTime, bool aproximate, uint64_t occupancyVersion = 0);
+
+    /**
+     * @brief Builds the key of a Pareto (driving-walking-pareto) query.
+     */
+    static QueryKey paretoQuery(Vertex<int>* source, Vertex<int>* destination, const std::vector<Vertex<int>*>& nAvoid,
+        const std::vector<Edge<int>*>& eAvoid, uint64_t occupancyVersion = 0);
+
+    /**
+     * @brief Approximate amount of memory used by the key, including its vectors.
+     */
+    size_t memoryUsage() const;
+
+private:
+    void setRestrictions(const std::vector<Vertex<int>*>& nAvoid, const std::vector<Edge<int>*>& eAvoid);
+};
+
+struct QueryKeyHash
+{
+    size_t operator()(const QueryKey& key) const;
+};
+
+/**
+ * @brief Thread-safe LRU cache holding the results of previously answered queries.
+ *
+ * The cache is bounded by an approximate memory budget, once an insertion goes over it the least recently
+ * used entries are dropped until it fits again. Hit and miss counters are kept for every lookup.
+ */
+class ResultCache
+{
+public:
+    static const size_t DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+    explicit ResultCache(size_t capacityBytes = DEFAULT_CAPACITY);
+
+    /**
+     * @brief Looks for the result of a query, marking it as the most recently used on a hit.
+     *
+     * @param key Canonical query.
+     * @param result Filled with the cached result when the query is found.
+     * @return true on a hit, false otherwise.
+     *
+     * O(|key|) average time complexity.
+     */
+    bool lookup(const QueryKey& key, QueryResult& result);
+
+    /**
+     * @brief Stores the result of a query, evicting least recently used entries if the memory budget is exceeded.
+     *
+     * Results bigger than the whole budget are not stored.
+     *
+     * O(|key| + |result|) average time complexity.
+     */
+    void insert(const QueryKey& key, const QueryResult& result);
+
+    /**
+     * @brief Drops every entry, used whenever the graph changes. Counters are kept.
+     */
+    void clear();
+
+    unsigned long getHits() const;
+    unsigned long getMisses() const;
+    size_t getMemoryUsage() const;
+    size_t getCapacity() const;
+    size_t size() const;
+
+    void setCapacity(size_t capacityBytes);
+
+private:
+    typedef std::pair<QueryKey, QueryResult> Entry;
+
+    std::list<Entry> entries; // most recently used at the front
+    std::unordered_map<QueryKey, std::list<Entry>::iterator, QueryKeyHash> index;
+    size_t capacity;
+    size_t usage = 0;
+    std::atomic<unsigned long> hits{0}, misses{0};
+    mutable std::mutex mtx;
+
+    static size_t entrySize(const Entry& entry);
+    void evict();
+};
+
+#endif //RESULT_CACHE_H
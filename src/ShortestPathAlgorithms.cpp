@@ -1,116 +1,394 @@
 #include "ShortestPathAlgorithms.h"
 #include "ParseFile.h"
+#include "Parallel.h"
+#include "RelaxKernel.h"
+#include "Metrics.h"
+#include "QueryBudget.h"
+#include <cmath>
+#include <thread>
 
 using namespace std;
 
-extern Vertex<int>* must;
 
-
-template <class T>
-bool relax(Edge<T>* edge) { // d[u] + w(u,v) < d[v]
-    if (edge->getOrig()->getDist() + edge->getDriveTime() < edge->getDest()->getDist()) { // we have found a better way to reach v
-        edge->getDest()->setDist(edge->getOrig()->getDist() + edge->getDriveTime()); // d[v] = d[u] + w(u,v)
+template <class Metric, class T>
+bool relaxEdge(Edge<T>* edge) { // d[u] + w(u,v) < d[v]
+    if (edge->getOrig()->getDist() + Metric::weight(edge) < edge->getDest()->getDist()) { // we have found a better way to reach v
+        edge->getDest()->setDist(edge->getOrig()->getDist() + Metric::weight(edge)); // d[v] = d[u] + w(u,v)
         edge->getDest()->setPath(edge); // set the predecessor of v to u; in this case the edge from u to v
         return true;
     }
     return false;
 }
 
+template <class T>
+bool relax(Edge<T>* edge) {
+    return relaxEdge<DriveMetric>(edge);
+}
+
 template <class T>
 bool walkingRelax(Edge<T>* edge) {
-    if (edge->getOrig()->getDist() + edge->getWalkTime() < edge->getDest()->getDist()) { // we have found a better way to reach v
-        edge->getDest()->setDist(edge->getOrig()->getDist() + edge->getWalkTime()); // d[v] = d[u] + w(u,v)
-        edge->getDest()->setPath(edge); // set the predecessor of v to u; in this case the edge from u to v
-        return true;
-    }
-    return false;
+    return relaxEdge<WalkMetric>(edge);
+}
+
+/**
+ * Tie-break of deltaStepping between two edges reaching the same vertex equally well, so its tree doesn't depend on
+ * the order threads relax them in: the one from the closer vertex, then from the lower index vertex, then the lower
+ * index edge.
+ */
+template <class T>
+static bool preferredPath(const Edge<T>* e, const Edge<T>* current) {
+    if (current == nullptr) return false; // the origin
+    const Vertex<T>* u = e->getOrig();
+    const Vertex<T>* c = current->getOrig();
+    if (u->getDist() != c->getDist()) return u->getDist() < c->getDist();
+    if (u->getIndex() != c->getIndex()) return u->getIndex() < c->getIndex();
+    return e->getIndex() < current->getIndex();
 }
 
+//* Snapshot of the adjacency of the last graph searched, rebuilt when the graph changes
 template <class T>
-static void dijkstra(Graph<T>* g, Vertex<T>* origin, Distance d) {
+static const CompactAdjacency<T>& searchAdjacency(const Graph<T>* g) {
+    static CompactAdjacency<T> adjacency;
+    adjacency.refresh(g);
+    return adjacency;
+}
+
+template <class Metric, class Queue, class T, class Restrictions>
+void dijkstraKernel(Graph<T>* g, Vertex<T>* origin, const Restrictions& restrictions) {
+    const CompactAdjacency<T>& adjacency = searchAdjacency(g);
+    const vector<Vertex<T>*>& vertices = adjacency.vertices();
+    const int* targets = adjacency.targets();
+    const double* weights = Metric::weights(adjacency);
+    //* Distances by position, the same as the vertices' dist but contiguous for the block comparisons
+    static vector<double> labels;
+    labels.assign(vertices.size(), INF);
+
     // Initialize the vertices
-    for (auto v : g->getVertexSet()) {
+    for (auto v : vertices) {
         v->setDist(INF);
         v->setPath(nullptr);
     }
-    auto s = origin;
-    s->setDist(0);
+    origin->setDist(0);
+    labels[adjacency.position(origin->getIndex())] = 0;
 
-    MutablePriorityQueue<Vertex<T>> q;
-    q.insert(s);
+    uint64_t settled = 0, relaxed = 0;
+    QueryBudget* budget = QueryBudget::active();
+    Queue q;
+    q.insert(origin);
     while (!q.empty()) {
-        auto v = q.extractMin();
-        if (v->isVisited()) continue; // Ignore vertices that are marked as visited
-        for (auto e : v->getAdj()) {
-            if (e->isSelected()) continue; // Ignore edges that are marked as selected
-            auto oldDist = e->getDest()->getDist();
-            switch (d) {
-            case Distance::drive:
-                if (relax(e)) {
+        Vertex<T>* v = q.extractMin();
+        if (restrictions.stopsAt(v->getIndex())) continue; // Ignore vertices that are blocked or skipped
+        if (budget != nullptr && !budget->settle()) break;
+        settled++;
+        double dist = v->getDist();
+        int position = adjacency.position(v->getIndex());
+        int end = adjacency.endEdge(position);
+        for (int first = adjacency.firstEdge(position); first < end; first += RELAX_BLOCK) {
+            int count = min(RELAX_BLOCK, end - first);
+            uint64_t improved = count < RELAX_SIMD_MIN_DEGREE
+                ? improvedTargetsScalar(targets + first, weights + first, count, dist, labels.data())
+                : improvedTargets(targets + first, weights + first, count, dist, labels.data());
+            while (improved != 0) {
+                int i = first + lowestBit(improved);
+                improved &= improved - 1;
+                Edge<T>* e = adjacency.edge(i);
+                int w = targets[i];
+                if (restrictions.excludes(e->getIndex(), vertices[w]->getIndex())) continue; // Ignore blocked edges and vertices
+                //* Compared again, an earlier edge of the block may have improved the same target
+                double oldDist = labels[w];
+                if (dist + weights[i] < oldDist) {
+                    relaxed++;
+                    labels[w] = dist + weights[i];
+                    vertices[w]->setDist(labels[w]);
+                    vertices[w]->setPath(e);
                     if (oldDist == INF) {
-                        q.insert(e->getDest());
+                        q.insert(vertices[w]);
                     }
                     else {
-                        q.decreaseKey(e->getDest());
+                        q.decreaseKey(vertices[w]);
                     }
                 }
-                break;
-            case Distance::walk:
-                if (walkingRelax(e)) {
-                    if (oldDist == INF) {
-                        q.insert(e->getDest());
-                    }
-                    else {
-                        q.decreaseKey(e->getDest());
-                    }
+            }
+        }
+    }
+    Metrics::add(Metrics::searches);
+    Metrics::add(Metrics::settledVertices, settled);
+    Metrics::add(Metrics::relaxedEdges, relaxed);
+}
+
+//* The loop of timeDependentDijkstra, plain relaxations since weights depend on the distance they are added to
+template <class T, class Restrictions>
+static void timeDependentKernel(Graph<T>* g, Vertex<T>* origin, double departure, const TravelTimeProfiles<T>& profiles, const Restrictions& restrictions) {
+    const CompactAdjacency<T>& adjacency = searchAdjacency(g);
+    const vector<Vertex<T>*>& vertices = adjacency.vertices();
+    const int* targets = adjacency.targets();
+    const double* driveTimes = adjacency.driveTimes();
+
+    for (auto v : vertices) {
+        v->setDist(INF);
+        v->setPath(nullptr);
+    }
+    origin->setDist(0);
+
+    uint64_t settled = 0, relaxed = 0;
+    QueryBudget* budget = QueryBudget::active();
+    MutablePriorityQueue<Vertex<T>> q;
+    q.insert(origin);
+    while (!q.empty()) {
+        Vertex<T>* v = q.extractMin();
+        if (restrictions.stopsAt(v->getIndex())) continue;
+        if (budget != nullptr && !budget->settle()) break;
+        settled++;
+        double dist = v->getDist();
+        int position = adjacency.position(v->getIndex());
+        for (int i = adjacency.firstEdge(position); i < adjacency.endEdge(position); i++) {
+            if (driveTimes[i] == INF) continue; // can't be driven at any time
+            Edge<T>* e = adjacency.edge(i);
+            Vertex<T>* w = vertices[targets[i]];
+            if (restrictions.excludes(e->getIndex(), w->getIndex())) continue;
+            double arrival = dist + (profiles.hasProfile(e) ? profiles.travelTime(e, departure + dist) : driveTimes[i]);
+            double oldDist = w->getDist();
+            if (arrival < oldDist) {
+                relaxed++;
+                w->setDist(arrival);
+                w->setPath(e);
+                if (oldDist == INF) {
+                    q.insert(w);
+                }
+                else {
+                    q.decreaseKey(w);
                 }
-                break;
             }
         }
     }
+    Metrics::add(Metrics::searches);
+    Metrics::add(Metrics::settledVertices, settled);
+    Metrics::add(Metrics::relaxedEdges, relaxed);
 }
 
 template <class T>
-void restrictedDrivingDijkstra(Graph<T>* g, Vertex<T>* origin, vector<Vertex<T>*> nAvoid, vector<Edge<T>*> eAvoid, Vertex<T>* must) {
-    resetGraph(g);
-    prepareRestrictedGraph(nAvoid, eAvoid);
+void timeDependentDijkstra(Graph<T>* g, Vertex<T>* origin, double departure, const TravelTimeProfiles<T>& profiles, const RestrictionMask* mask) {
+    if (mask == nullptr) timeDependentKernel(g, origin, departure, profiles, NoRestrictions());
+    else timeDependentKernel(g, origin, departure, profiles, *mask);
+}
+
+//* Picks the kernel for a Distance and an optional mask
+template <class Queue, class T>
+static void dispatchDijkstra(Graph<T>* g, Vertex<T>* origin, Distance d, const RestrictionMask* mask) {
+    if (mask == nullptr) {
+        if (d == Distance::drive) dijkstraKernel<DriveMetric, Queue>(g, origin, NoRestrictions());
+        else dijkstraKernel<WalkMetric, Queue>(g, origin, NoRestrictions());
+    }
+    else {
+        if (d == Distance::drive) dijkstraKernel<DriveMetric, Queue>(g, origin, *mask);
+        else dijkstraKernel<WalkMetric, Queue>(g, origin, *mask);
+    }
+}
+
+template <class T>
+static void dijkstra(Graph<T>* g, Vertex<T>* origin, Distance d, const RestrictionMask* mask) {
+    dispatchDijkstra<MutablePriorityQueue<Vertex<T>>>(g, origin, d, mask);
+}
+
+template <class T>
+void cachedDijkstra(Graph<T>* g, Vertex<T>* origin, Distance d, const vector<Vertex<T>*>& nAvoid, const vector<Edge<T>*>& eAvoid, ShortestPathTreeCache<T>* cache, const RestrictionMask* mask) {
+    if (cache == nullptr) {
+        dijkstra(g, origin, d, mask);
+        return;
+    }
+    PathTreeKey key = ShortestPathTreeCache<T>::makeKey(origin, d, nAvoid, eAvoid);
+    if (cache->restore(g, key)) return;
+    dijkstra(g, origin, d, mask);
+    //* a search stopped by its query budget left a partial tree
+    QueryBudget* budget = QueryBudget::active();
+    if (budget != nullptr && budget->isExhausted()) return;
+    cache->store(g, key);
+}
+
+template <class T>
+void distanceMatrix(Graph<T>* g, const vector<Vertex<T>*>& points, Distance d, const RestrictionMask* mask, vector<vector<double>>& matrix) {
+    matrix.assign(points.size(), vector<double>(points.size(), INF));
+    bool parallel = g->getCodeVertex() >= DELTA_STEPPING_MIN_VERTICES && thread::hardware_concurrency() > 1;
+    for (size_t i = 0; i < points.size(); i++) {
+        if (parallel) deltaStepping(g, points[i], d, mask);
+        else dispatchDijkstra<LazyPriorityQueue<Vertex<T>>>(g, points[i], d, mask);
+        for (size_t j = 0; j < points.size(); j++) {
+            matrix[i][j] = (i == j) ? 0 : points[j]->getDist();
+        }
+    }
+}
+
+template <class T>
+void deltaStepping(Graph<T>* g, Vertex<T>* origin, Distance d, const RestrictionMask* mask, unsigned threads) {
+    struct Request
+    {
+        int v;
+        double dist;
+    };
+
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    vector<Vertex<T>*> vertexSet = g->getVertexSet();
+    size_t n = vertexSet.size();
+    shared_ptr<const EdgeWeights> weights = g->getWeights();
+    auto weight = [d, &weights](Edge<T>* e) { return d == Distance::drive ? weights->driveTime(e->getIndex()) : weights->walkTime(e->getIndex()); };
+
+    //* Bucket width is the mean finite weight, rounded since travel times are integers
+    double total = 0;
+    size_t count = 0;
+    for (Vertex<T>* v : vertexSet) {
+        for (Edge<T>* e : v->getAdj()) {
+            if (weight(e) == INF) continue;
+            total += weight(e);
+            count++;
+        }
+    }
+    double delta = count ? max(1.0, floor(total / count + 0.5)) : 1;
+
+    vector<double> dist(n, INF);
+    vector<vector<int>> buckets;
+    auto place = [&](int v) {
+        size_t b = (size_t)(dist[v] / delta);
+        if (b >= buckets.size()) buckets.resize(b + 1);
+        buckets[b].push_back(v);
+    };
+    vector<vector<Request>> requests(threads);
+
+    //* each thread scans the edges of its share of vertices, light or heavy ones only, into its own request buffer
+    auto generate = [&](const vector<int>& from, bool light) {
+        parallelFor(from.size(), threads, [&](size_t begin, size_t end, unsigned t) {
+            for (size_t i = begin; i < end; i++) {
+                Vertex<T>* u = vertexSet[from[i]];
+                if (mask != nullptr && mask->stopsAt(from[i])) continue;
+                for (Edge<T>* e : u->getAdj()) {
+                    double w = weight(e);
+                    if (w == INF || (w <= delta) != light) continue;
+                    if (mask != nullptr && mask->excludes(e->getIndex(), e->getDest()->getIndex())) continue;
+                    requests[t].push_back({ e->getDest()->getIndex(), dist[from[i]] + w });
+                }
+            }
+        });
+        for (vector<Request>& buffer : requests) {
+            for (const Request& r : buffer) {
+                if (r.dist < dist[r.v]) {
+                    dist[r.v] = r.dist;
+                    place(r.v);
+                }
+            }
+            buffer.clear();
+        }
+    };
+
+    vector<bool> inBucket(n, false);
+    dist[origin->getIndex()] = 0;
+    place(origin->getIndex());
+    for (size_t i = 0; i < buckets.size(); i++) {
+        vector<int> settled;
+        while (!buckets[i].empty()) {
+            vector<int> frontier;
+            frontier.swap(buckets[i]);
+            //* entries whose distance went down to an earlier part of the bucket are repeated, only the latest matters
+            vector<int> current;
+            for (int v : frontier) {
+                if ((size_t)(dist[v] / delta) != i) continue;
+                current.push_back(v);
+                if (!inBucket[v]) {
+                    inBucket[v] = true;
+                    settled.push_back(v);
+                }
+            }
+            sort(current.begin(), current.end());
+            current.erase(unique(current.begin(), current.end()), current.end());
+            generate(current, true);
+        }
+        generate(settled, false);
+        for (int v : settled) inBucket[v] = false;
+    }
+
+    parallelFor(n, threads, [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; i++) {
+            vertexSet[i]->setDist(dist[i]);
+        }
+    });
+    //* The path of each vertex is an optimal incoming edge, the same one whatever the threads did (preferredPath)
+    parallelFor(n, threads, [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; i++) {
+            Vertex<T>* v = vertexSet[i];
+            Edge<T>* best = nullptr;
+            Edge<T>* zeroWeight = nullptr; //* only taken when no positive weight edge is optimal
+            if (v != origin && dist[i] != INF) {
+                for (Edge<T>* e : v->getIncoming()) {
+                    Vertex<T>* u = e->getOrig();
+                    if (mask != nullptr && (mask->stopsAt(u->getIndex()) || mask->excludes(e->getIndex(), (int)i))) continue;
+                    if (dist[u->getIndex()] + weight(e) != dist[i]) continue;
+                    if (weight(e) <= 0) zeroWeight = e;
+                    else if (best == nullptr || preferredPath(e, best)) best = e;
+                }
+            }
+            v->setPath(best != nullptr ? best : zeroWeight);
+        }
+    });
+}
+
+template <class T>
+void restrictedDrivingDijkstra(Graph<T>* g, Vertex<T>* origin, vector<Vertex<T>*> nAvoid, vector<Edge<T>*> eAvoid, Vertex<T>* must, RestrictionMask& mask, ShortestPathTreeCache<T>* cache) {
+    mask.clear();
+    prepareRestrictedGraph(mask, nAvoid, eAvoid);
     if (must) {
-        dijkstra(g, must, Distance::drive);
+        cachedDijkstra(g, must, Distance::drive, nAvoid, eAvoid, cache, &mask);
     }
     else {
-        dijkstra(g, origin, Distance::drive);
+        cachedDijkstra(g, origin, Distance::drive, nAvoid, eAvoid, cache, &mask);
     }
 }
 
 template <class T>
-static double getPath(Graph<T>* g, Vertex<T>* origin, Vertex<T>* dest, vector<T>& res, const bool& rev) {
-    res.clear();
-    auto v = dest;
-    double dist = v->getDist();
-    if (v == nullptr || v->getDist() == INF) { // missing or disconnected
+static double appendPath(Vertex<T>* origin, Vertex<T>* dest, vector<T>& res, const bool& rev, RestrictionMask* mark) {
+    if (dest == nullptr || dest->getDist() == INF) { // missing or disconnected
         return -1;
     }
-    res.push_back(v->getInfo());
+    double dist = dest->getDist();
+    //* First walk finds the length of the path (and marks it), so the second one can put every id in its place
+    size_t length = 1;
+    Vertex<T>* v = dest;
     while (v->getPath() != nullptr) {
-        v->getPath()->setSelected(true);
-        v->getPath()->getReverse()->setSelected(true);
+        if (mark != nullptr) {
+            mark->blockEdge(v->getPath()->getIndex());
+            mark->blockEdge(v->getPath()->getReverse()->getIndex());
+        }
         v = v->getPath()->getOrig();
-        v->setVisited(true);
-        res.push_back(v->getInfo());
+        //* the start of the path is never skipped
+        if (mark != nullptr && v->getPath() != nullptr) mark->skipVertex(v->getIndex());
+        length++;
     }
-    int s = res.size() - 1;
-    if (rev){
-        reverse(res.begin(), res.end());
-        s = 0;
+    size_t first = res.size();
+    res.resize(first + length);
+    v = dest;
+    for (size_t i = 0; i < length; i++) {
+        res[rev ? first + length - 1 - i : first + i] = v->getInfo();
+        if (v->getPath() != nullptr) v = v->getPath()->getOrig();
     }
-    if (res.empty() || res[s] != origin->getInfo()) {
+    if (v->getInfo() != origin->getInfo()) {
         cout << "No Path Found!!" << endl;
         return -1;
     }
-    v->setVisited(false);
     return dist;
 }
 
+template <class T>
+static double getPath(Graph<T>* g, Vertex<T>* origin, Vertex<T>* dest, vector<T>& res, const bool& rev, RestrictionMask* mark) {
+    res.clear();
+    return appendPath(origin, dest, res, rev, mark);
+}
+
+template <class T>
+static void treePath(const vector<Edge<T>*>& tree, Vertex<T>* v, vector<T>& res) {
+    res.clear();
+    res.push_back(v->getInfo());
+    for (Edge<T>* e = tree[v->getIndex()]; e != nullptr; e = tree[e->getOrig()->getIndex()]) {
+        res.push_back(e->getOrig()->getInfo());
+    }
+}
+
 template <class T>
 static double getRestrictedPath(Graph<T>* g, Vertex<T>* origin, Vertex<T>* dest, Vertex<T>* must, vector<T>& res) {
     res.clear();
@@ -122,49 +400,38 @@ static double getRestrictedPath(Graph<T>* g, Vertex<T>* origin, Vertex<T>* dest,
         auto v_must = must;
         if (!v_origin || !v_must) return -1;
 
-        vector<T> res1, res2;
-
-        double dist1 = getPath(g, must, origin, res1, true);
-        double dist2 = getPath(g, must, dest, res2, true);
-
-        if (dist1 == -1 || dist2 == -1) return -1;
-
-        reverse(res1.begin(), res1.end());
-        if (!res1.empty()) {
-            res1.pop_back();
-        }
-        res.insert(res.end(), res1.begin(), res1.end());
-        res.insert(res.end(), res2.begin(), res2.end());
+        //* The tree is rooted at must: the path of origin read as it is goes origin..must, and the one of dest
+        //* read backwards goes must..dest, so both are written straight into res, must only once
+        double dist1 = appendPath(must, origin, res, false, nullptr);
+        if (dist1 == -1) return -1;
+        res.pop_back();
+        double dist2 = appendPath(must, dest, res, true, nullptr);
+        if (dist2 == -1) return -1;
 
         return dist1 + dist2;
     }
 
-    return getPath(g, origin, dest, res, true);
+    return getPath(g, origin, dest, res, true, nullptr);
 }
 
 template <class T>
-static void resetGraph(Graph<T>* g) {
-    for (Vertex<T>* v : g->getVertexSet()) {
-        v->setVisited(false);
-        for (Edge<T>* e : v->getAdj()) {
-            e->setSelected(false);
-        }
+static void selectPath(const vector<Edge<T>*>& path, RestrictionMask& mark) {
+    for (Edge<T>* e : path) {
+        mark.blockEdge(e->getIndex());
+        mark.blockEdge(e->getReverse()->getIndex());
+        if (e != path.front()) mark.skipVertex(e->getOrig()->getIndex());
     }
 }
 
 template <class T>
-static void prepareRestrictedGraph(vector<Vertex<T>*> nA, vector<Edge<T>*> nE) {
+static void prepareRestrictedGraph(RestrictionMask& mask, const vector<Vertex<T>*>& nA, const vector<Edge<T>*>& nE) {
+    //* a blocked vertex can never be reached nor expanded, so its edges don't need to be touched
     for (Vertex<T>* v : nA) {
-        v->setVisited(true);
-        //* this is a suggestion so we can never get to the restricted vertex
-        for (Edge<T>* e : v->getAdj()) {
-            e->setSelected(true);
-            e->getReverse()->setSelected(true);
-        }
+        mask.blockVertex(v->getIndex());
     }
     for (Edge<T>* e : nE) {
-        e->setSelected(true);
-        e->getReverse()->setSelected(true);
+        mask.blockEdge(e->getIndex());
+        mask.blockEdge(e->getReverse()->getIndex());
     }
 }
 
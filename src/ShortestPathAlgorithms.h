@@ -3,6 +3,17 @@
 
 #include <Graph.h>
 #include <MutablePriorityQueue.h>
+#include <LazyPriorityQueue.h>
+#include <ShortestPathTreeCache.h>
+#include <RestrictionMask.h>
+#include <CompactAdjacency.h>
+#include <TravelTimeProfiles.h>
+#include <ComponentLabels.h>
+
+//* Graphs with at least this many vertices get the rows of distanceMatrix from deltaStepping when there are several cores
+#ifndef DELTA_STEPPING_MIN_VERTICES
+#define DELTA_STEPPING_MIN_VERTICES 100000
+#endif
 
 enum Distance
 {
@@ -10,6 +21,44 @@ enum Distance
     drive,
 };
 
+/**
+ * @brief Metric policies of the search kernels, each one gives the weight of an edge for one Distance.
+ * The weight is read directly instead of switching on the Distance for every edge.
+ */
+struct DriveMetric
+{
+    template <class T>
+    static double weight(const Edge<T>* e) { return e->getDriveTime(); }
+    template <class T>
+    static const double* weights(const CompactAdjacency<T>& adjacency) { return adjacency.driveTimes(); }
+};
+
+struct WalkMetric
+{
+    template <class T>
+    static double weight(const Edge<T>* e) { return e->getWalkTime(); }
+    template <class T>
+    static const double* weights(const CompactAdjacency<T>& adjacency) { return adjacency.walkTimes(); }
+};
+
+/**
+ * @brief Restriction policy of searches without restrictions. It has the same tests as RestrictionMask,
+ * which is the policy of restricted searches, but they are constants so the compiler removes them.
+ */
+struct NoRestrictions
+{
+    bool stopsAt(int) const { return false; }
+    bool excludes(int, int) const { return false; }
+};
+
+template <class Metric, class T>
+/**
+ * @brief Relaxes the edge with the weight given by Metric if a shorter path is found.
+ *
+ * O(1) time complexity, O(1) space complexity.
+ */
+bool relaxEdge(Edge<T>* edge);
+
 template <class T>
 /**
  * @brief Relaxes the edge if a shorter path is found. Modified to work with driving time
@@ -39,12 +88,107 @@ template <class T>
  * @param g Pointer to the graph on which the algorithm will be executed.
  * @param origin Pointer to the origin vertex from which the shortest paths will be calculated.
  * @param distance Decides between using Driving edges or Walking edges.
+ * @param mask Restrictions of the search (blocked/skipped vertices and blocked edges), nullptr if none.
  * 
  * O((E + V) log |V|) time complexity, O(|V|) space complexity.
  * 
  * @note The graph should not contain negative weight edges, as Dijkstra's algorithm does not handle them correctly.
  */
-void dijkstra(Graph<T>* g, Vertex<T>* origin, Distance distance);
+void dijkstra(Graph<T>* g, Vertex<T>* origin, Distance distance, const RestrictionMask* mask = nullptr);
+
+template <class Metric, class Queue, class T, class Restrictions>
+/**
+ * @brief The loop of dijkstra, generated separately for every combination of policies.
+ *
+ * dijkstra only picks the kernel for its Distance and mask, so every search without restrictions runs a loop
+ * with no restriction tests and no metric switch.
+ *
+ * Edges are read from a CompactAdjacency snapshot of the graph and the edges of each settled vertex are compared
+ * against the labels of their targets a block at a time with improvedTargets (SIMD where available). Only the
+ * improved targets are then updated, in edge order and with the same queue operations as relaxing one edge at a time.
+ *
+ * @tparam Metric DriveMetric or WalkMetric.
+ * @tparam Queue Priority queue of vertices, MutablePriorityQueue<Vertex<T>> (the one dijkstra uses, which decides
+ *               how ties are broken) or LazyPriorityQueue<Vertex<T>> when only distances matter.
+ * @tparam Restrictions NoRestrictions or RestrictionMask.
+ *
+ * O((E + V) log |V|) time complexity, O(|V|) space complexity, O(E) for LazyPriorityQueue.
+ */
+void dijkstraKernel(Graph<T>* g, Vertex<T>* origin, const Restrictions& restrictions);
+
+template <class T>
+/**
+ * @brief Time dependent dijkstra: earliest arrival driving times from a given origin leaving at a given time.
+ *
+ * The weight of an edge is its travel time when it is entered, profiles.travelTime(e, departure + dist), so edges
+ * with a profile cost what they cost at the time they are reached and the rest their fixed drive time. Since every
+ * profile is FIFO, waiting is never worth it and a vertex settled once is never improved later, so the search is exact.
+ * The dist of each vertex is the time taken to reach it (not the clock time) and path its last edge, as in dijkstra.
+ *
+ * @param departure Minutes after midnight when the origin is left.
+ * @param profiles Travel time profiles of the edges of g.
+ * @param mask Restrictions of the search, nullptr if none.
+ *
+ * O((E log B + V) log |V|) time complexity, where B is the amount of breakpoints of the longest profile, O(|V|) space complexity.
+ */
+void timeDependentDijkstra(Graph<T>* g, Vertex<T>* origin, double departure, const TravelTimeProfiles<T>& profiles, const RestrictionMask* mask = nullptr);
+
+template <class T>
+/**
+ * @brief Same as dijkstra, but the resulting shortest path tree is reused from the cache when a search with the
+ * same origin, distance and restrictions was already done, and stored in it otherwise.
+ *
+ * @param g Pointer to the graph, already prepared with the given restrictions.
+ * @param origin Pointer to the origin vertex.
+ * @param distance Decides between using Driving edges or Walking edges.
+ * @param nAvoid The vertices avoided when preparing the graph.
+ * @param eAvoid The edges avoided when preparing the graph.
+ * @param cache The tree cache to use, if nullptr this is a plain dijkstra.
+ * @param mask The restrictions built from nAvoid and eAvoid, nullptr if there are none.
+ *
+ * O(|V|) time complexity on a cache hit, the same as dijkstra otherwise.
+ */
+void cachedDijkstra(Graph<T>* g, Vertex<T>* origin, Distance distance, const std::vector<Vertex<T>*>& nAvoid, const std::vector<Edge<T>*>& eAvoid, ShortestPathTreeCache<T>* cache, const RestrictionMask* mask = nullptr);
+
+template <class T>
+/**
+ * @brief Many to many shortest distances, one search per source. Only distances are kept, so the searches are
+ * dijkstras with a LazyPriorityQueue, or deltaStepping on graphs of DELTA_STEPPING_MIN_VERTICES or more vertices
+ * when there are several hardware threads.
+ *
+ * @param g Pointer to the graph on which the algorithm will be executed.
+ * @param points The vertices of the matrix, every one of them is a source and a target.
+ * @param distance Decides between using Driving edges or Walking edges.
+ * @param mask Restrictions of the searches, nullptr if none.
+ * @param matrix Filled with matrix[i][j] = distance from points[i] to points[j], INF if there is no path.
+ *
+ * O(P (E + V) log |V|) time complexity, where P is the amount of points, O(P^2) space complexity.
+ */
+void distanceMatrix(Graph<T>* g, const std::vector<Vertex<T>*>& points, Distance distance, const RestrictionMask* mask, std::vector<std::vector<double>>& matrix);
+
+template <class T>
+/**
+ * @brief Parallel single source shortest paths (delta-stepping), meant for big source to all computations.
+ *
+ * Vertices are kept in buckets of width delta, the mean edge weight rounded to an integer (travel times are integers).
+ * The edges of each bucket are scanned by several threads at once, every thread writing its relaxation requests to its own
+ * buffer, which are then applied. Light edges (weight <= delta) are relaxed until the bucket is stable, heavy ones once after.
+ * The restrictions of the mask are followed just like in dijkstra.
+ *
+ * The dist fields are left exactly as dijkstra(g, origin, distance) leaves them. The path of each vertex is an optimal
+ * incoming edge, the one from the closest vertex, then the lowest index vertex, then the lowest index edge (a zero weight
+ * one only if no other is optimal). It is the same as dijkstra's wherever a single edge is optimal, where several are
+ * dijkstra keeps the first it relaxes, which depends on its heap. ./app --check-sssp compares both on a graph.
+ *
+ * @param g Pointer to the graph on which the algorithm will be executed.
+ * @param origin Pointer to the origin vertex.
+ * @param distance Decides between using Driving edges or Walking edges.
+ * @param mask Restrictions of the search, nullptr if none.
+ * @param threads Amount of threads to use, 0 uses every hardware thread.
+ *
+ * O(|V| + |E| + L) work, where L is the amount of buckets, split between the threads.
+ */
+void deltaStepping(Graph<T>* g, Vertex<T>* origin, Distance distance, const RestrictionMask* mask = nullptr, unsigned threads = 0);
 
 template <class T>
 /**
@@ -55,12 +199,15 @@ template <class T>
  * @param g Pointer to the graph on which the algorithm will be executed.
  * @param origin Pointer to the origin vertex from which the shortest paths will be calculated.
  * @param distance Decides between using Driving edges or Walking edges.
+ * @param mask Mask sized for g, cleared and filled with the restrictions, the graph itself is never changed.
+ * @param cache Optional shortest path tree cache, searches already done from the same origin (or must vertex)
+ *              with the same restrictions are not repeated.
  *
  * O((E + V) log |V|) time complexity, O(|V|) space complexity.
  *
  * @note The graph should not contain negative weight edges, as Dijkstra's algorithm does not handle them correctly.
  */
-void restrictedDrivingDijkstra(Graph<T>* g, Vertex<T>* origin, std::vector<Vertex<T>*> nAvoid, std::vector<Edge<T>*> eAvoid, Vertex<T>* must);
+void restrictedDrivingDijkstra(Graph<T>* g, Vertex<T>* origin, std::vector<Vertex<T>*> nAvoid, std::vector<Edge<T>*> eAvoid, Vertex<T>* must, RestrictionMask& mask, ShortestPathTreeCache<T>* cache = nullptr);
 
 template <class T>
 /**
@@ -69,8 +216,12 @@ template <class T>
  * @param g Pointer to the graph on which the algorithm will be executed.
  * @param origin Pointer to the origin vertex.
  * @param dest Pointer to the destination vertex.
- * @param res A vector to store the vertices in the path from origin to dest.
- * @param rev A boolean indicating whether to reverse the path at the end.
+ * @param res A vector to store the vertices in the path from origin to dest. It is only resized, so a vector reused
+ *            between calls keeps its memory.
+ * @param rev A boolean indicating whether the path goes from origin to dest (true) or from dest to origin (false).
+ *            The ids are written in that order directly, nothing is reversed afterwards.
+ * @param mark If not nullptr, the path is marked on it (edges blocked, inner vertices skipped) so a following search
+ *             with it looks for an alternative route.
  * @return The total distance of the path. Returns -1 if no valid path exists.
  * 
  * @warning The method assumes that the graph and vertices are properly initialized and valid.
@@ -79,7 +230,25 @@ template <class T>
  * O(|V|) where V is the ammount of vertices in the graph.
  * 
  */
-static double getPath(Graph<T>* g, Vertex<T>* origin, Vertex<T>* dest, std::vector<T>& res, const bool& rev);
+static double getPath(Graph<T>* g, Vertex<T>* origin, Vertex<T>* dest, std::vector<T>& res, const bool& rev, RestrictionMask* mark = nullptr);
+
+template <class T>
+/**
+ * @brief Same as getPath, but the path is added after what res already holds instead of replacing it.
+ */
+static double appendPath(Vertex<T>* origin, Vertex<T>* dest, std::vector<T>& res, const bool& rev, RestrictionMask* mark = nullptr);
+
+template <class T>
+/**
+ * @brief Path from a vertex to the root of a shortest path tree saved earlier, in that order.
+ *
+ * @param tree The path edge of every vertex by index, as a search left them, nullptr for the root and unreached vertices.
+ * @param v A vertex reached by that search.
+ * @param res Filled with the ids of the vertices on the path.
+ *
+ * O(|path|) time complexity.
+ */
+static void treePath(const std::vector<Edge<T>*>& tree, Vertex<T>* v, std::vector<T>& res);
 
 template <class T>
 /**
@@ -105,24 +274,27 @@ static double getRestrictedPath(Graph<T>* g, Vertex<T>* origin, Vertex<T>* dest,
 
 template <class T>
 /**
- * @brief Resets the graph to close to its initial state, having all vertex and nodes be unselected.
- * 
- * O(|V| + |E|) time complexity, O(1) space complexity the method itself does not alocate extra space.
+ * @brief Marks a path the same way getPath does: every edge and its reverse blocked, and every vertex
+ * but the first and the last skipped, so a following search looks for an alternative to it.
+ *
+ * @param path The edges of the path, in order.
+ * @param mark The mask the path is marked on.
+ *
+ * O(|path|) time complexity.
  */
-static void resetGraph(Graph<T>* g);
-
+static void selectPath(const std::vector<Edge<T>*>& path, RestrictionMask& mark);
 
 template <class T>
 /**
- * @brief Prepares a restricted graph by marking specified vertices and edges as visited or selected so they are ignored in the algorithm.
- *
+ * @brief Writes the restrictions of a query to a mask, so the specified vertices and edges are ignored by the algorithms.
+ * The graph itself is not changed, and lifting the restrictions is just clearing the mask.
  *
+ * @param mask The mask the restrictions are written to, sized for the graph.
  * @param nA A vector of pointers to the vertices that should be avoided.
- * @param nE A vector of pointers to the edges that should be avoided.
+ * @param nE A vector of pointers to the edges that should be avoided, their reverse is avoided as well.
  * 
- * O(|E| + |V|) time complexity, O(1) space complexity the method itself does not alocate extra space.
- * where V is the amount of vertices and E the amount of edges in the vectors, which worst case are the same as the graph.
+ * O(|nA| + |nE|) time complexity, O(1) space complexity the method itself does not alocate extra space.
  */
-static void prepareRestrictedGraph(std::vector<Vertex<T>*> nA, std::vector<Edge<T>*> nE);
+static void prepareRestrictedGraph(RestrictionMask& mask, const std::vector<Vertex<T>*>& nA, const std::vector<Edge<T>*>& nE);
 
 #endif //SHORTESTPATHALGORITHMS_H
@@ -0,0 +1,129 @@
+#include "WaypointOrder.h"
+#include <Graph.h>
+#include <algorithm>
+using namespace std;
+
+static double add(double a, double b) {
+    return (a == INF || b == INF) ? INF : a + b;
+}
+
+//* Total distance of start -> order -> end
+static double routeCost(const vector<vector<double>>& cost, const vector<int>& order) {
+    int end = cost.size() - 1;
+    double total = 0;
+    int previous = 0;
+    for (int stop : order) {
+        total = add(total, cost[previous][stop]);
+        previous = stop;
+    }
+    return add(total, cost[previous][end]);
+}
+
+static double exactOrder(const vector<vector<double>>& cost, vector<int>& order) {
+    int k = cost.size() - 2, end = k + 1;
+    int full = (1 << k) - 1;
+    //* best[set][j]: shortest route from the start visiting exactly the stops in set, ending at stop j (in set)
+    vector<vector<double>> best(full + 1, vector<double>(k, INF));
+    vector<vector<int>> previous(full + 1, vector<int>(k, -1));
+    for (int j = 0; j < k; j++) best[1 << j][j] = cost[0][j + 1];
+    for (int set = 1; set <= full; set++) {
+        for (int j = 0; j < k; j++) {
+            if (!(set & (1 << j)) || best[set][j] == INF) continue;
+            for (int next = 0; next < k; next++) {
+                if (set & (1 << next)) continue;
+                double d = add(best[set][j], cost[j + 1][next + 1]);
+                int grown = set | (1 << next);
+                if (d < best[grown][next]) {
+                    best[grown][next] = d;
+                    previous[grown][next] = j;
+                }
+            }
+        }
+    }
+
+    double total = INF;
+    int last = -1;
+    for (int j = 0; j < k; j++) {
+        double d = add(best[full][j], cost[j + 1][end]);
+        if (d < total) {
+            total = d;
+            last = j;
+        }
+    }
+    order.clear();
+    if (last == -1) return INF;
+    for (int set = full, j = last; j != -1;) {
+        order.push_back(j + 1);
+        int p = previous[set][j];
+        set ^= 1 << j;
+        j = p;
+    }
+    reverse(order.begin(), order.end());
+    return total;
+}
+
+static double heuristicOrder(const vector<vector<double>>& cost, vector<int>& order) {
+    int k = cost.size() - 2, end = k + 1;
+    //* Cheapest insertion: every stop goes where it makes the route grow the least
+    vector<int> route = { 0, end };
+    for (int stop = 1; stop <= k; stop++) {
+        size_t at = 1;
+        double growth = INF;
+        for (size_t i = 1; i < route.size(); i++) {
+            double d = add(cost[route[i - 1]][stop], cost[stop][route[i]]);
+            if (d != INF) d -= (cost[route[i - 1]][route[i]] == INF ? 0 : cost[route[i - 1]][route[i]]);
+            if (d < growth) {
+                growth = d;
+                at = i;
+            }
+        }
+        route.insert(route.begin() + at, stop);
+    }
+    order.assign(route.begin() + 1, route.end() - 1);
+
+    //* Local search: reversing a segment or moving a single stop elsewhere, while any of them shortens the route
+    double total = routeCost(cost, order);
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        for (int i = 0; i < k; i++) {
+            for (int j = i + 1; j < k; j++) {
+                reverse(order.begin() + i, order.begin() + j + 1);
+                double d = routeCost(cost, order);
+                if (d < total) {
+                    total = d;
+                    improved = true;
+                }
+                else {
+                    reverse(order.begin() + i, order.begin() + j + 1);
+                }
+            }
+        }
+        for (int i = 0; i < k; i++) {
+            for (int j = 0; j < k; j++) {
+                if (i == j) continue;
+                int stop = order[i];
+                order.erase(order.begin() + i);
+                order.insert(order.begin() + j, stop);
+                double d = routeCost(cost, order);
+                if (d < total) {
+                    total = d;
+                    improved = true;
+                }
+                else {
+                    order.erase(order.begin() + j);
+                    order.insert(order.begin() + i, stop);
+                }
+            }
+        }
+    }
+    return total;
+}
+
+double orderWaypoints(const vector<vector<double>>& cost, vector<int>& order) {
+    int k = cost.size() - 2;
+    order.clear();
+    if (k <= 0) return cost.empty() ? INF : cost[0].back();
+    if (k <= WAYPOINT_EXACT_LIMIT) return exactOrder(cost, order);
+    return heuristicOrder(cost, order);
+}
@@ -0,0 +1,27 @@
+#ifndef WAYPOINT_ORDER_H
+#define WAYPOINT_ORDER_H
+
+#include <vector>
+
+//* Up to this amount of stops the visiting order is exact (dynamic programming), beyond it a heuristic is used
+#ifndef WAYPOINT_EXACT_LIMIT
+#define WAYPOINT_EXACT_LIMIT 12
+#endif
+
+/**
+ * @brief Chooses the order in which to visit a set of stops on a route with a fixed start and end.
+ *
+ * cost[i][j] is the shortest distance from point i to point j, where point 0 is the start, points 1..k are
+ * the stops and point k + 1 is the end. The matrix does not need to be symmetric.
+ *
+ * Up to WAYPOINT_EXACT_LIMIT stops the optimal order is found with the Held-Karp dynamic programming over subsets,
+ * in O(2^k k^2) time. With more stops a cheapest insertion order is improved with segment reversals and single stop
+ * moves until no move helps, in O(k^3) time per improvement pass.
+ *
+ * @param cost The (k + 2) x (k + 2) distance matrix, INF where there is no path.
+ * @param order Filled with the stops (1..k) in visiting order.
+ * @return The total distance of the route, INF if the stops can't all be visited.
+ */
+double orderWaypoints(const std::vector<std::vector<double>>& cost, std::vector<int>& order);
+
+#endif //WAYPOINT_ORDER_H
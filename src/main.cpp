@@ -1,9 +1,33 @@
 #include "CLInterface.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
 
 // * This exists basically just to control the project, the aim is to mimic the class structure we used in ldts
 
 
 int main(int argc, char* argv []) {
+    //* METRICS_FILE=<file> dumps query statistics to that file in Prometheus text format every METRICS_INTERVAL seconds
+    std::unique_ptr<MetricsDumper> metrics;
+    if (const char* metricsFile = std::getenv("METRICS_FILE")) {
+        const char* interval = std::getenv("METRICS_INTERVAL");
+        int seconds = interval != nullptr ? std::atoi(interval) : 0;
+        metrics.reset(new MetricsDumper(metricsFile, seconds > 0 ? seconds : METRICS_DUMP_INTERVAL));
+    }
+    //* OCCUPANCY_FEED=<file> gives the occupied spaces of the car parks, reread every OCCUPANCY_INTERVAL seconds
+    if (const char* occupancyFile = std::getenv("OCCUPANCY_FEED")) {
+        const char* interval = std::getenv("OCCUPANCY_INTERVAL");
+        int seconds = interval != nullptr ? std::atoi(interval) : 0;
+        CLInterface::followOccupancyFeed(occupancyFile, seconds > 0 ? seconds : OCCUPANCY_FEED_INTERVAL);
+    }
+    //* HUB_LABELS=<directory> looks up waypoint distances in the hub labels written there by --hub-labels
+    if (const char* hubLabels = std::getenv("HUB_LABELS")) CLInterface::useHubLabels(hubLabels);
+    //* QUERY_DEADLINE_MS=<ms> and QUERY_MAX_SETTLED=<vertices> stop slow queries, which are answered with a Timeout
+    QueryLimits limits;
+    if (const char* deadline = std::getenv("QUERY_DEADLINE_MS")) limits.deadline = std::chrono::milliseconds(std::max(0LL, std::atoll(deadline)));
+    if (const char* maxSettled = std::getenv("QUERY_MAX_SETTLED")) limits.maxSettled = std::max(0LL, std::atoll(maxSettled));
+    CLInterface::setQueryLimits(limits);
     CLInterface interface;
     // ./app locations.csv distances.csv input.txt output.txt
     switch (argc) {
@@ -23,6 +47,16 @@ int main(int argc, char* argv []) {
             std::cout << "./app locations.csv distances.csv\n   \033[90m- for interface with custom files\033[0m" << std::endl;
             std::cout << "./app locations.csv distances.csv output.txt\n   \033[90m- for interface with custom files and output to file\033[0m" << std::endl;
             std::cout << "./app locations.csv distances.csv input.txt output.txt\n   \033[90m- for execution without interface of custom files, input file and output to file\033[0m" << std::endl;
+            std::cout << "./app --to-binary locations.csv distances.csv input.txt requests.bin\n   \033[90m- to convert an input file to the binary requests format, which can then be given as the input file\033[0m" << std::endl;
+            std::cout << "./app --to-text locations.csv distances.csv file.bin file.txt\n   \033[90m- to convert binary requests or results to text\033[0m" << std::endl;
+            std::cout << "./app --partition locations.csv distances.csv directory\n   \033[90m- to write the graph as region files and an overlay, for queries that only load the regions they need\033[0m" << std::endl;
+            std::cout << "./app --check-sssp locations.csv distances.csv\n   \033[90m- to check that the parallel shortest paths search gives the same trees as dijkstra\033[0m" << std::endl;
+            std::cout << "./app --regions directory requests.bin results.bin\n   \033[90m- to answer the shortest driving routes of binary requests from the files written by --partition, without the csv files\033[0m" << std::endl;
+            std::cout << "./app --hub-labels locations.csv distances.csv directory\n   \033[90m- to write the driving and walking hub labels of the graph, for distance lookups without searches\033[0m" << std::endl;
+            std::cout << "A Profiles.csv next to distances.csv, if there is one, gives the drive times of queries with a Departure line" << std::endl;
+            std::cout << "QUERY_DEADLINE_MS=ms and QUERY_MAX_SETTLED=vertices limit each query, the ones over them are answered with Timeout,\n   a query can set its own with Deadline and MaxSettled lines, and Ctrl-C cancels the queries of a batch" << std::endl;
+            std::cout << "HUB_LABELS=directory orders waypoints with the driving hub labels written there by --hub-labels" << std::endl;
+            std::cout << "OCCUPANCY_FEED=occupancy.csv keeps eco and Pareto routes away from full car parks (the last column of locations.csv is their capacity)" << std::endl;
             return 0;
         }
         else {
@@ -45,6 +79,7 @@ int main(int argc, char* argv []) {
         break;
     }
     case 4: {
+        if (std::string(argv[1]) == "--check-sssp") return interface.checkDeltaStepping(argv[2], argv[3]);
         std::string locatinsFileName = argv[1];
         std::string distancesFileName = argv[2];
         std::string outputFileName = argv[3];
@@ -59,7 +94,24 @@ int main(int argc, char* argv []) {
         break;
     }
           // Same as case 4, but the default will be to output to a file, which should be the final argument
+          // (or, with --partition, writes the graph as region files for queries that don't load all of it, with
+          // --regions answers binary requests from those files, and with --hub-labels writes its hub labels)
     case 5: {
+        if (std::string(argv[1]) == "--partition") {
+            if (interface.partitionGraph(argv[2], argv[3], argv[4])) return 1;
+            std::cout << "Partition written to " << argv[4] << std::endl;
+            break;
+        }
+        if (std::string(argv[1]) == "--regions") {
+            if (interface.answerFromRegions(argv[2], argv[3], argv[4])) return 1;
+            std::cout << "Result written to " << argv[4] << std::endl;
+            break;
+        }
+        if (std::string(argv[1]) == "--hub-labels") {
+            if (interface.buildHubLabels(argv[2], argv[3], argv[4])) return 1;
+            std::cout << "Hub labels written to " << argv[4] << std::endl;
+            break;
+        }
         std::string locatinsFileName = argv[1];
         std::string distancesFileName = argv[2];
         std::string inputFileName = argv[3];
@@ -68,6 +120,18 @@ int main(int argc, char* argv []) {
         interface.defaultRun(locatinsFileName, distancesFileName, inputFileName, outputFileName);
         std::cout << "Result written to " << outputFileName << std::endl;
         break;
+    }
+          // Converts a batch between the text and the binary formats, nothing is answered
+    case 6: {
+        std::string option = argv[1];
+        if (option != "--to-binary" && option != "--to-text") {
+            std::cerr << "Invalid argument" << std::endl;
+            std::cerr << "Usage: ./app -h - for help" << std::endl;
+            return 1;
+        }
+        if (interface.convertBatch(option == "--to-binary", argv[2], argv[3], argv[4], argv[5])) return 1;
+        std::cout << "Result written to " << argv[5] << std::endl;
+        break;
     }
           // Can either End the program right away with an error message
           // or send the error message and send the user to the interactive menu